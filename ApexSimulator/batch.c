@@ -0,0 +1,495 @@
+/*
+ *  batch.c
+ *  Runs a manifest of simulation jobs on a pool of worker threads
+ *
+ *  Manifest : one job per line, blank lines and '#' comments are skipped
+ *
+ *    <input_file|checkpoint> <cycles> [mem=<address>:<count>] [policy=<name>] [width=<n>]
+ *                                     [unit=<spec>]... [bpred=<spec>] [icache=<spec>] [dcache=<spec>]
+ *                                     [ooo=<spec>]
+ *
+ *  Every distinct input file is parsed once and its code memory is shared
+ *  by all the CPUs that run it. A checkpoint written by apex_sim save=
+ *  is restored for each job that names it, so many jobs can fan out from
+ *  one warmed-up state. Jobs are dealt out to per-worker deques;
+ *  a worker pops from the back of its own deque and, once that is empty,
+ *  steals from the front of the others. With -c cache_dir, programs are
+ *  loaded through the pre-decoded images in cache_dir, see image.c.
+ *
+ *  policy= picks the hazard policy of the job (interlock, forward or
+ *  forward_lu), otherwise a checkpoint keeps its own and a program uses
+ *  interlock. width= sets how many instructions the pipeline handles per
+ *  cycle, otherwise a checkpoint keeps its own and a program uses 1.
+ *  unit= sets the timing of a functional unit as apex_sim does,
+ *  the others keep those of the checkpoint, or 1:1 for a program.
+ *  bpred= gives the job a new, untrained branch predictor, icache= and
+ *  dcache= a new, empty instruction or data cache. ooo= runs a program on
+ *  the out-of-order engine of that size; a checkpoint keeps the back end
+ *  it was saved with. mem= adds count words of data memory, at most
+ *  1024, from address on to the row of the job. A job with a bad cycle
+ *  count or option, an option that does not apply to its checkpoint, or
+ *  a file that cannot be loaded is not run and gets an error row, and
+ *  the exit status is then 1.
+ *
+ *  Output : one CSV row per job, in manifest order
+ *
+ *    job,input_file,policy,cycles,retired,R0,...,R15,CC[,MEM[address],...]
+ */
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+/* A parsed program, shared read-only by every job that runs it */
+typedef struct Program
+{
+  char* filename;
+  APEX_Instruction* code_memory;
+  int code_memory_size;
+  int is_checkpoint;
+} Program;
+
+/* One line of the manifest and, once run, its result */
+typedef struct Job
+{
+  int program;
+  int no_of_cycles;
+  uint32_t mem_address;
+  int mem_count;
+  int policy;   // -1 for the default
+  int width;    // 0 for the default
+  APEX_Unit units[NUM_UNITS]; // Latency 0 for the default
+  char* bpred;  // Branch predictor spec, NULL for the default
+  char* icache; // Instruction cache spec, NULL for the default
+  char* dcache; // Data cache spec, NULL for the default
+  char* ooo;    // Out-of-order engine spec, NULL for the in-order pipeline
+  int invalid;  // Set if an option is bad, the job is then not run
+
+  int done;
+  int clock;
+  int ins_completed;
+  int regs[17];
+  int* data;
+} Job;
+
+/* Job indices owned by one worker, the owner takes from the tail and
+ * thieves take from the head */
+typedef struct Deque
+{
+  pthread_mutex_t lock;
+  int* jobs;
+  int head;
+  int tail;
+} Deque;
+
+typedef struct Pool
+{
+  Program* programs;
+  Job* jobs;
+  Deque* deques;
+  int num_workers;
+} Pool;
+
+typedef struct Worker
+{
+  Pool* pool;
+  int id;
+} Worker;
+
+static int
+deque_pop(Deque* deque)
+{
+  int job = -1;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    job = deque->jobs[--deque->tail];
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return job;
+}
+
+static int
+deque_steal(Deque* deque)
+{
+  int job = -1;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail) {
+    job = deque->jobs[deque->head++];
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return job;
+}
+
+/*
+ * Applies the options of job to cpu. Returns the option that does not
+ * apply to it, e.g. an ooo= to a checkpoint with a running back end,
+ * or NULL once all of them are in place.
+ */
+static const char*
+configure_job(APEX_CPU* cpu, Job* job)
+{
+  if (job->policy >= 0 && APEX_cpu_set_hazard_policy(cpu, job->policy) != 0) {
+    return "policy=";
+  }
+  if (job->width && APEX_cpu_set_width(cpu, job->width) != 0) {
+    return "width=";
+  }
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    if (job->units[unit].latency) {
+      cpu->units[unit] = job->units[unit];
+    }
+  }
+  if (job->bpred && APEX_bpred_configure(&cpu->bpred, job->bpred) != 0) {
+    return "bpred=";
+  }
+  if (job->icache && APEX_cache_configure(&cpu->icache, job->icache) != 0) {
+    return "icache=";
+  }
+  if (job->dcache && APEX_cache_configure(&cpu->dcache, job->dcache) != 0) {
+    return "dcache=";
+  }
+  if (job->ooo && APEX_ooo_configure(cpu, job->ooo) != 0) {
+    return "ooo=";
+  }
+  return NULL;
+}
+
+/* Runs job, leaving it not done, and so an error row, if it cannot be set up */
+static void
+run_job(Pool* pool, Job* job)
+{
+  Program* program = &pool->programs[job->program];
+  APEX_CPU* cpu = program->is_checkpoint
+                    ? APEX_cpu_load(program->filename)
+                    : APEX_cpu_create(program->code_memory, program->code_memory_size);
+  if (!cpu) {
+    return;
+  }
+  cpu->enable_debug_messages = 0;
+  const char* option = configure_job(cpu, job);
+  if (option) {
+    fprintf(stderr, "APEX_Error : %s does not apply to %s\n", option, program->filename);
+    APEX_cpu_stop(cpu);
+    return;
+  }
+  job->policy = cpu->hazard_policy;
+  APEX_cpu_simulate(cpu, job->no_of_cycles);
+
+  job->clock = cpu->clock;
+  job->ins_completed = cpu->ins_completed;
+  memcpy(job->regs, cpu->regs, sizeof(job->regs));
+  if (job->mem_count) {
+    job->data = malloc(sizeof(int) * job->mem_count);
+    if (job->data) {
+      for (int i = 0; i < job->mem_count; ++i) {
+        job->data[i] = APEX_memory_read(&cpu->data_memory, job->mem_address + i);
+      }
+    }
+  }
+  job->done = 1;
+  APEX_cpu_stop(cpu);
+}
+
+static void*
+worker_main(void* arg)
+{
+  Worker* worker = arg;
+  Pool* pool = worker->pool;
+  for (;;) {
+    int job = deque_pop(&pool->deques[worker->id]);
+    /* Own deque is empty, look for work elsewhere. No job creates new
+     * jobs, so once every deque is empty the batch is done. */
+    for (int i = 1; job < 0 && i < pool->num_workers; ++i) {
+      job = deque_steal(&pool->deques[(worker->id + i) % pool->num_workers]);
+    }
+    if (job < 0) {
+      return NULL;
+    }
+    run_job(pool, &pool->jobs[job]);
+  }
+}
+
+/* Returns the index of filename in programs, parsing it on first use */
+static int
+find_program(Program** programs, int* num_programs, const char* filename, const char* cache_dir)
+{
+  for (int i = 0; i < *num_programs; ++i) {
+    if (strcmp((*programs)[i].filename, filename) == 0) {
+      return i;
+    }
+  }
+  Program* grown = realloc(*programs, sizeof(Program) * (*num_programs + 1));
+  if (!grown) {
+    return -1;
+  }
+  *programs = grown;
+  Program* program = &grown[*num_programs];
+  program->filename = strdup(filename);
+  program->code_memory = NULL;
+  program->is_checkpoint = 0;
+
+  if (APEX_is_checkpoint(filename)) {
+    /* Restore once up front to reject checkpoints from another build */
+    APEX_CPU* checkpoint = APEX_cpu_load(filename);
+    if (checkpoint) {
+      program->is_checkpoint = 1;
+      APEX_cpu_stop(checkpoint);
+    }
+  } else {
+    program->code_memory = APEX_load_program(filename, cache_dir, &program->code_memory_size);
+  }
+  if (!program->code_memory && !program->is_checkpoint) {
+    fprintf(stderr, "APEX_Error : Unable to load %s\n", filename);
+  }
+  return (*num_programs)++;
+}
+
+static int
+read_manifest(const char* manifest, const char* cache_dir, Program** programs, int* num_programs, Job** jobs, int* num_jobs)
+{
+  FILE* fp = fopen(manifest, "r");
+  if (!fp) {
+    return -1;
+  }
+
+  char* line = NULL;
+  size_t len = 0;
+  int line_no = 0;
+  int capacity = 0;
+  while (getline(&line, &len, fp) != -1) {
+    line_no++;
+    char* save_ptr = NULL;
+    char* filename = strtok_r(line, " \t\r\n", &save_ptr);
+    if (!filename || filename[0] == '#') {
+      continue;
+    }
+    char* cycles = strtok_r(NULL, " \t\r\n", &save_ptr);
+    if (!cycles) {
+      fprintf(stderr, "APEX_Error : %s:%d: missing cycle count\n", manifest, line_no);
+      continue;
+    }
+
+    if (*num_jobs == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      Job* grown = realloc(*jobs, sizeof(Job) * capacity);
+      if (!grown) {
+        break;
+      }
+      *jobs = grown;
+    }
+    Job* job = &(*jobs)[*num_jobs];
+    memset(job, 0, sizeof(*job));
+    job->policy = -1;
+    char* end;
+    long no_of_cycles = strtol(cycles, &end, 0);
+    if (*end || no_of_cycles < 0 || no_of_cycles > INT_MAX) {
+      fprintf(stderr, "APEX_Error : %s:%d: invalid cycle count %s\n", manifest, line_no, cycles);
+      job->invalid = 1;
+    } else {
+      job->no_of_cycles = no_of_cycles;
+    }
+
+    char* option;
+    while ((option = strtok_r(NULL, " \t\r\n", &save_ptr)) != NULL) {
+      if (strncmp(option, "policy=", 7) == 0) {
+        job->policy = APEX_hazard_policy_from_name(option + 7);
+        if (job->policy < 0) {
+          fprintf(stderr, "APEX_Error : %s:%d: unknown hazard policy %s\n", manifest, line_no, option + 7);
+          job->invalid = 1;
+        }
+      } else if (strncmp(option, "width=", 6) == 0) {
+        job->width = strtol(option + 6, NULL, 0);
+        if (job->width < 1 || job->width > APEX_MAX_WIDTH) {
+          fprintf(stderr, "APEX_Error : %s:%d: invalid width %s\n", manifest, line_no, option + 6);
+          job->width = 0;
+          job->invalid = 1;
+        }
+      } else if (strncmp(option, "bpred=", 6) == 0) {
+        APEX_BranchPredictor scratch;
+        if (APEX_bpred_configure(&scratch, option + 6) != 0) {
+          fprintf(stderr, "APEX_Error : %s:%d: invalid branch predictor %s\n", manifest, line_no, option + 6);
+          job->invalid = 1;
+        } else {
+          free(job->bpred);
+          job->bpred = strdup(option + 6);
+        }
+      } else if (strncmp(option, "icache=", 7) == 0 || strncmp(option, "dcache=", 7) == 0) {
+        APEX_Cache scratch;
+        char** spec = option[0] == 'i' ? &job->icache : &job->dcache;
+        if (APEX_cache_configure(&scratch, option + 7) != 0) {
+          fprintf(stderr, "APEX_Error : %s:%d: invalid cache %s\n", manifest, line_no, option);
+          job->invalid = 1;
+        } else {
+          free(*spec);
+          *spec = strdup(option + 7);
+        }
+      } else if (strncmp(option, "ooo=", 4) == 0) {
+        /* Checked against a cpu that has not run, like the one of a program */
+        APEX_CPU* scratch = calloc(1, sizeof(APEX_CPU));
+        if (!scratch || APEX_ooo_configure(scratch, option + 4) != 0) {
+          fprintf(stderr, "APEX_Error : %s:%d: invalid out-of-order engine %s\n", manifest, line_no, option + 4);
+          job->invalid = 1;
+        } else {
+          free(job->ooo);
+          job->ooo = strdup(option + 4);
+        }
+        free(scratch);
+      } else if (strncmp(option, "unit=", 5) == 0) {
+        if (APEX_set_unit(job->units, option + 5) != 0) {
+          fprintf(stderr, "APEX_Error : %s:%d: invalid functional unit %s\n", manifest, line_no, option + 5);
+          job->invalid = 1;
+        }
+      } else if (sscanf(option, "mem=%" SCNu32 ":%d", &job->mem_address, &job->mem_count) != 2 ||
+          job->mem_count < 0 || job->mem_count > APEX_PAGE_WORDS) {
+        fprintf(stderr, "APEX_Error : %s:%d: bad option %s\n", manifest, line_no, option);
+        job->mem_address = job->mem_count = 0;
+        job->invalid = 1;
+      }
+    }
+
+    job->program = find_program(programs, num_programs, filename, cache_dir);
+    if (job->program < 0) {
+      break;
+    }
+    (*num_jobs)++;
+  }
+
+  free(line);
+  fclose(fp);
+  return 0;
+}
+
+static void
+print_job(FILE* out, Program* programs, Job* job, int index)
+{
+  fprintf(out, "%d,%s", index, programs[job->program].filename);
+  if (!job->done) {
+    fprintf(out, ",error\n");
+    return;
+  }
+  fprintf(out, ",%s,%d,%d", hazard_policy_names[job->policy], job->clock, job->ins_completed);
+  for (int i = 0; i < 17; ++i) {
+    fprintf(out, ",%d", job->regs[i]);
+  }
+  for (int i = 0; job->data && i < job->mem_count; ++i) {
+    fprintf(out, ",%d", job->data[i]);
+  }
+  fprintf(out, "\n");
+}
+
+int
+main(int argc, char const* argv[])
+{
+  const char* manifest = NULL;
+  const char* output = NULL;
+  const char* cache_dir = NULL;
+  int num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      num_workers = strtol(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (!manifest) {
+      manifest = argv[i];
+    } else {
+      manifest = NULL;
+      break;
+    }
+  }
+  if (!manifest) {
+    fprintf(stderr, "APEX_Help : Usage %s <manifest> [-j threads] [-o output] [-c cache_dir]\n", argv[0]);
+    exit(1);
+  }
+  if (num_workers < 1) {
+    num_workers = 1;
+  }
+
+  Pool pool = { 0 };
+  int num_programs = 0;
+  int num_jobs = 0;
+  if (read_manifest(manifest, cache_dir, &pool.programs, &num_programs, &pool.jobs, &num_jobs) < 0) {
+    fprintf(stderr, "APEX_Error : Unable to read %s\n", manifest);
+    exit(1);
+  }
+
+  /* Deal the runnable jobs round-robin over the workers, a job with a bad
+   * option or program is left out and reported as an error row */
+  pool.num_workers = num_workers;
+  pool.deques = calloc(num_workers, sizeof(Deque));
+  Worker* workers = calloc(num_workers, sizeof(Worker));
+  pthread_t* threads = calloc(num_workers, sizeof(pthread_t));
+  if (!pool.deques || !workers || !threads) {
+    fprintf(stderr, "APEX_Error : Out of memory\n");
+    exit(1);
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    pthread_mutex_init(&pool.deques[i].lock, NULL);
+    pool.deques[i].jobs = malloc(sizeof(int) * (num_jobs / num_workers + 1));
+  }
+  for (int i = 0; i < num_jobs; ++i) {
+    Program* program = &pool.programs[pool.jobs[i].program];
+    if (!pool.jobs[i].invalid && (program->code_memory || program->is_checkpoint)) {
+      Deque* deque = &pool.deques[i % num_workers];
+      deque->jobs[deque->tail++] = i;
+    }
+  }
+
+  for (int i = 0; i < num_workers; ++i) {
+    workers[i].pool = &pool;
+    workers[i].id = i;
+    if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+      fprintf(stderr, "APEX_Error : Unable to start worker thread %d\n", i);
+      exit(1);
+    }
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  FILE* out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "APEX_Error : Unable to open %s\n", output);
+    exit(1);
+  }
+  fprintf(out, "job,input_file,policy,cycles,retired");
+  for (int i = 0; i < 16; ++i) {
+    fprintf(out, ",R%d", i);
+  }
+  fprintf(out, ",CC\n");
+  int failed = 0;
+  for (int i = 0; i < num_jobs; ++i) {
+    print_job(out, pool.programs, &pool.jobs[i], i);
+    failed |= !pool.jobs[i].done;
+    free(pool.jobs[i].data);
+    free(pool.jobs[i].bpred);
+    free(pool.jobs[i].icache);
+    free(pool.jobs[i].dcache);
+    free(pool.jobs[i].ooo);
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  for (int i = 0; i < num_workers; ++i) {
+    pthread_mutex_destroy(&pool.deques[i].lock);
+    free(pool.deques[i].jobs);
+  }
+  for (int i = 0; i < num_programs; ++i) {
+    free(pool.programs[i].filename);
+    free(pool.programs[i].code_memory);
+  }
+  free(pool.programs);
+  free(pool.jobs);
+  free(pool.deques);
+  free(workers);
+  free(threads);
+  return failed;
+}
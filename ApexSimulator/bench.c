@@ -0,0 +1,101 @@
+/*
+ *  bench.c
+ *  apex_bench : measures host simulation speed on a set of programs
+ *
+ *  Usage : apex_bench [-c max_cycles] [-p policy] <input_file> ...
+ *
+ *  Each program is parsed, then simulated quietly until HALT or until
+ *  max_cycles; only the simulation is timed. One row is printed per
+ *  program with the hazard policy, simulated cycles, retired
+ *  instructions, simulated IPC, host seconds and host simulated-cycles
+ *  per second, followed by a total row. apex_bench_<policy> is built for
+ *  a single hazard policy; -p selects the policy of the run-time
+ *  selectable apex_bench.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu.h"
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+print_row(const char* name, const char* policy, long cycles, long retired, double seconds)
+{
+  printf("%-24s %-10s %12ld %12ld %7.3f %9.3f %10.2f\n", name, policy, cycles, retired,
+         cycles ? (double) retired / cycles : 0.0, seconds,
+         seconds > 0 ? cycles / seconds / 1e6 : 0.0);
+}
+
+int
+main(int argc, char const* argv[])
+{
+  int max_cycles = 100000000;
+  int policy = -1;
+  int first = 1;
+  while (first + 1 < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-c") == 0) {
+      max_cycles = strtol(argv[first + 1], NULL, 0);
+    } else if (strcmp(argv[first], "-p") == 0) {
+      policy = APEX_hazard_policy_from_name(argv[first + 1]);
+      if (policy < 0) {
+        fprintf(stderr, "APEX_Error : Unknown hazard policy %s\n", argv[first + 1]);
+        exit(1);
+      }
+    } else {
+      break;
+    }
+    first += 2;
+  }
+  if (first >= argc) {
+    fprintf(stderr, "APEX_Help : Usage %s [-c max_cycles] [-p policy] <input_file> ...\n", argv[0]);
+    exit(1);
+  }
+
+  printf("%-24s %-10s %12s %12s %7s %9s %10s\n", "program", "policy", "cycles", "retired", "IPC", "host_s", "Mcycles/s");
+  long total_cycles = 0;
+  long total_retired = 0;
+  double total_seconds = 0;
+  int failed = 0;
+  for (int i = first; i < argc; ++i) {
+    int code_memory_size;
+    APEX_Instruction* code_memory = create_code_memory(argv[i], &code_memory_size);
+    APEX_CPU* cpu = APEX_cpu_create(code_memory, code_memory_size);
+    if (!cpu) {
+      fprintf(stderr, "APEX_Error : Unable to load %s\n", argv[i]);
+      free(code_memory);
+      failed = 1;
+      continue;
+    }
+    cpu->enable_debug_messages = 0;
+    if (policy >= 0 && APEX_cpu_set_hazard_policy(cpu, policy) != 0) {
+      fprintf(stderr, "APEX_Error : Hazard policy %s is not available in this build\n", hazard_policy_names[policy]);
+      exit(1);
+    }
+
+    double start = now();
+    APEX_cpu_simulate(cpu, max_cycles);
+    double seconds = now() - start;
+
+    const char* name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    print_row(name, hazard_policy_names[cpu->hazard_policy], cpu->stats.cycles, cpu->ins_completed, seconds);
+    if (!cpu->halted) {
+      fprintf(stderr, "APEX_Error : %s did not reach HALT in %d cycles\n", argv[i], max_cycles);
+    }
+    total_cycles += cpu->stats.cycles;
+    total_retired += cpu->ins_completed;
+    total_seconds += seconds;
+    APEX_cpu_stop(cpu);
+    free(code_memory);
+  }
+  print_row("total", "", total_cycles, total_retired, total_seconds);
+  return failed;
+}
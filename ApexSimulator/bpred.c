@@ -0,0 +1,173 @@
+/*
+ *  bpred.c
+ *  Contains the branch predictors and branch target buffer of fetch
+ *
+ *  A predictor is configured from
+ *
+ *    <none|static|bimodal|gshare>[:<table_bits>[:<btb_entries>[:<history_bits>]]]
+ *
+ *  with 2^table_bits 2-bit counters (10 by default), a direct mapped BTB
+ *  of btb_entries entries (64 by default) and, for gshare, history_bits
+ *  of global history (table_bits by default). fetch asks for the next PC
+ *  of every BZ, BNZ and JUMP it hands to decode; EX2 resolves the branch
+ *  and trains the counters, the history and the BTB with its outcome, in
+ *  program order. By then older branches in flight have shifted the
+ *  history, so the branch carries the index of the counter it was
+ *  predicted with, and that counter is the one trained. A JUMP is
+ *  always taken: it neither reads nor trains a counter, nor enters the
+ *  history, where it would only alias with the conditional branches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+const char* const bpred_names[NUM_BPREDS] = {
+  [BPRED_NONE] = "none",
+  [BPRED_STATIC] = "static",
+  [BPRED_BIMODAL] = "bimodal",
+  [BPRED_GSHARE] = "gshare",
+};
+
+/* Counter of the branch at pc */
+static int
+counter_index(const APEX_BranchPredictor* bpred, int pc)
+{
+  uint32_t index = pc / 4;
+  if (bpred->kind == BPRED_GSHARE) {
+    index ^= bpred->history & ((1u << bpred->history_bits) - 1);
+  }
+  return index & ((1u << bpred->table_bits) - 1);
+}
+
+/*
+ * Sets up an untrained predictor from spec, see the top of this file.
+ * Returns -1, leaving bpred untouched, if spec is not valid.
+ */
+int
+APEX_bpred_configure(APEX_BranchPredictor* bpred, const char* spec)
+{
+  size_t len = strcspn(spec, ":");
+  int kind = -1;
+  for (int i = 0; i < NUM_BPREDS; ++i) {
+    if (strlen(bpred_names[i]) == len && strncmp(bpred_names[i], spec, len) == 0) {
+      kind = i;
+    }
+  }
+  long field[3] = { 10, 64, -1 };
+  const char* p = spec + len;
+  for (int i = 0; i < 3 && *p == ':'; ++i) {
+    char* end;
+    field[i] = strtol(p + 1, &end, 0);
+    if (end == p + 1) {
+      return -1;
+    }
+    p = end;
+  }
+  long table_bits = field[0], btb_entries = field[1];
+  long history_bits = field[2] < 0 ? table_bits : field[2];
+  if (kind < 0 || *p || table_bits < 1 || table_bits > APEX_BPRED_MAX_TABLE_BITS ||
+      btb_entries < 1 || btb_entries > APEX_BTB_MAX_ENTRIES || history_bits < 0 || history_bits > table_bits) {
+    return -1;
+  }
+  memset(bpred, 0, sizeof(*bpred));
+  bpred->kind = kind;
+  bpred->table_bits = table_bits;
+  bpred->history_bits = history_bits;
+  bpred->btb_entries = btb_entries;
+  /* Weakly taken */
+  memset(bpred->counters, 2, sizeof(bpred->counters));
+  return 0;
+}
+
+/*
+ * Returns 1 if bpred, restored from outside this run, has sizes
+ * APEX_bpred_configure could have set up and a BTB whose targets are
+ * instructions of a code memory of code_memory_size entries.
+ */
+int
+APEX_bpred_valid(const APEX_BranchPredictor* bpred, int code_memory_size)
+{
+  if (bpred->kind == BPRED_NONE) {
+    return 1;
+  }
+  if (bpred->kind < 0 || bpred->kind >= NUM_BPREDS ||
+      bpred->table_bits < 1 || bpred->table_bits > APEX_BPRED_MAX_TABLE_BITS ||
+      bpred->btb_entries < 1 || bpred->btb_entries > APEX_BTB_MAX_ENTRIES ||
+      bpred->history_bits < 0 || bpred->history_bits > bpred->table_bits) {
+    return 0;
+  }
+  for (int i = 0; i < bpred->btb_entries; ++i) {
+    const APEX_BtbEntry* entry = &bpred->btb[i];
+    if (entry->pc && (entry->target % 4 != 0 || entry->target < 4000 ||
+                      get_code_index(entry->target) >= code_memory_size)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Returns the PC fetch goes on to after the BZ, BNZ or JUMP at pc: the
+ * target the BTB holds for it if the branch is predicted taken, else the
+ * next instruction. The counter consulted goes to *counter, for
+ * APEX_bpred_update.
+ */
+int
+APEX_bpred_predict(APEX_BranchPredictor* bpred, int pc, int op, int imm, uint16_t* counter)
+{
+  int taken;
+  *counter = counter_index(bpred, pc);
+  switch (bpred->kind) {
+  case BPRED_STATIC:
+    taken = op == OP_JUMP || imm < 0;
+    break;
+  case BPRED_BIMODAL:
+  case BPRED_GSHARE:
+    taken = op == OP_JUMP || bpred->counters[*counter] >= 2;
+    break;
+  default:
+    taken = 0;
+    break;
+  }
+  if (!taken) {
+    return pc + 4;
+  }
+  const APEX_BtbEntry* entry = &bpred->btb[(pc / 4) % bpred->btb_entries];
+  if (entry->pc != pc) {
+    bpred->btb_misses++;
+    return pc + 4;
+  }
+  return entry->target;
+}
+
+/*
+ * Trains bpred with the outcome of the branch op at pc, which went to
+ * target if taken. counter is the one APEX_bpred_predict returned for it.
+ */
+void
+APEX_bpred_update(APEX_BranchPredictor* bpred, int pc, int op, int counter, int taken, int target, int mispredicted)
+{
+  bpred->branches++;
+  bpred->taken += taken;
+  bpred->mispredicted += mispredicted;
+  if (bpred->kind == BPRED_NONE) {
+    return;
+  }
+  if (op != OP_JUMP) {
+    /* Masked, the predictor may have been replaced since, e.g. on a restored cpu */
+    uint8_t* state = &bpred->counters[counter & ((1u << bpred->table_bits) - 1)];
+    if (taken && *state < 3) {
+      (*state)++;
+    } else if (!taken && *state > 0) {
+      (*state)--;
+    }
+    bpred->history = (bpred->history << 1) | (taken != 0);
+  }
+  if (taken) {
+    APEX_BtbEntry* entry = &bpred->btb[(pc / 4) % bpred->btb_entries];
+    entry->pc = pc;
+    entry->target = target;
+  }
+}
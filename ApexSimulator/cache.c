@@ -0,0 +1,205 @@
+/*
+ *  cache.c
+ *  Contains the set-associative cache timing model
+ *
+ *  A cache is configured from
+ *
+ *    <size>:<ways>:<line>:<miss_penalty>[:lru|plru][:wb|wt]
+ *
+ *  size and line are in words. wb (the default) is write-back with write
+ *  allocate, wt is write-through without write allocate; a write-through
+ *  store never waits, its miss is absorbed by a write buffer. Only tags
+ *  are kept, so a cache changes when a LOAD or STORE completes, never
+ *  what it reads or writes. The L1 data caches of a multi-core system
+ *  are write-back and also go through the MESI directory of coherence.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+const char* const replacement_names[NUM_REPLACEMENTS] = {
+  [REPLACE_LRU] = "lru",
+  [REPLACE_PLRU] = "plru",
+};
+
+/* Points the tree of a set away from way, which was just used */
+static void
+plru_touch(uint16_t* tree, int ways, int way)
+{
+  int node = 1;
+  for (int half = ways / 2; half >= 1; half /= 2) {
+    int right = (way & half) != 0;
+    if (right) {
+      *tree &= ~(1 << node);
+    } else {
+      *tree |= 1 << node;
+    }
+    node = 2 * node + right;
+  }
+}
+
+/* Follows the tree of a set to the way it points at */
+static int
+plru_victim(uint16_t tree, int ways)
+{
+  int node = 1;
+  int way = 0;
+  for (int half = ways / 2; half >= 1; half /= 2) {
+    int right = (tree >> node) & 1;
+    way |= right ? half : 0;
+    node = 2 * node + right;
+  }
+  return way;
+}
+
+static void
+touch(APEX_Cache* cache, int set, int way)
+{
+  cache->lines[set * cache->ways + way].last_use = ++cache->accesses;
+  if (cache->replacement == REPLACE_PLRU) {
+    plru_touch(&cache->plru[set], cache->ways, way);
+  }
+}
+
+/* Way of set a fill goes to: an invalid one if any, else the one the replacement policy picks */
+static int
+victim(const APEX_Cache* cache, int set)
+{
+  const APEX_CacheLine* lines = &cache->lines[set * cache->ways];
+  int oldest = 0;
+  for (int way = 0; way < cache->ways; ++way) {
+    if (!lines[way].valid) {
+      return way;
+    }
+    if (lines[way].last_use < lines[oldest].last_use) {
+      oldest = way;
+    }
+  }
+  return cache->replacement == REPLACE_PLRU ? plru_victim(cache->plru[set], cache->ways) : oldest;
+}
+
+/*
+ * Sets up an empty cache from spec, see the top of this file.
+ * Returns -1, leaving cache untouched, if spec is not valid.
+ */
+int
+APEX_cache_configure(APEX_Cache* cache, const char* spec)
+{
+  char* end;
+  long field[4];
+  const char* p = spec;
+  for (int i = 0; i < 4; ++i) {
+    field[i] = strtol(p, &end, 0);
+    if (end == p || (*end != ':' && (i < 3 || *end))) {
+      return -1;
+    }
+    p = *end ? end + 1 : end;
+  }
+  long size = field[0], ways = field[1], line_words = field[2], miss_penalty = field[3];
+  int replacement = REPLACE_LRU;
+  int write_back = 1;
+  while (*p) {
+    size_t len = strcspn(p, ":");
+    if (len == 3 && strncmp(p, "lru", 3) == 0) {
+      replacement = REPLACE_LRU;
+    } else if (len == 4 && strncmp(p, "plru", 4) == 0) {
+      replacement = REPLACE_PLRU;
+    } else if (len == 2 && strncmp(p, "wb", 2) == 0) {
+      write_back = 1;
+    } else if (len == 2 && strncmp(p, "wt", 2) == 0) {
+      write_back = 0;
+    } else {
+      return -1;
+    }
+    p += len + (p[len] == ':');
+  }
+  if (ways < 1 || ways > APEX_CACHE_MAX_WAYS || line_words < 1 || miss_penalty < 0 || miss_penalty > 4096 ||
+      size < ways * line_words || size % (ways * line_words) != 0 || size / line_words > APEX_CACHE_MAX_LINES) {
+    return -1;
+  }
+  /* The PLRU tree halves the ways at every level */
+  if (replacement == REPLACE_PLRU && (ways & (ways - 1)) != 0) {
+    return -1;
+  }
+  memset(cache, 0, sizeof(*cache));
+  cache->sets = size / (ways * line_words);
+  cache->ways = ways;
+  cache->line_words = line_words;
+  cache->miss_penalty = miss_penalty;
+  cache->replacement = replacement;
+  cache->write_back = write_back;
+  return 0;
+}
+
+/*
+ * Returns 1 if cache, restored from outside this run, has a geometry
+ * APEX_cache_configure could have set up, or is no cache at all.
+ */
+int
+APEX_cache_valid(const APEX_Cache* cache)
+{
+  if (cache->sets == 0) {
+    return !cache->coherence;
+  }
+  return cache->sets > 0 && cache->ways >= 1 && cache->ways <= APEX_CACHE_MAX_WAYS &&
+         cache->sets <= APEX_CACHE_MAX_LINES / cache->ways && cache->line_words >= 1 &&
+         cache->miss_penalty >= 0 && cache->miss_penalty <= 4096 &&
+         cache->replacement >= 0 && cache->replacement < NUM_REPLACEMENTS &&
+         (cache->replacement != REPLACE_PLRU || (cache->ways & (cache->ways - 1)) == 0) &&
+         !cache->coherence;
+}
+
+/*
+ * Looks up the word at address for a read, or a write if is_write, and
+ * updates the tags and counters. Returns the cycles the access takes
+ * beyond a hit: the miss penalty for a fill, once more if it writes a
+ * dirty line back, and for the bus transactions of coherence.
+ */
+int
+APEX_cache_access(APEX_Cache* cache, uint32_t address, int is_write)
+{
+  uint32_t line = address / cache->line_words;
+  int set = line % cache->sets;
+  uint32_t tag = line / cache->sets;
+  APEX_CacheLine* lines = &cache->lines[set * cache->ways];
+  for (int way = 0; way < cache->ways; ++way) {
+    if (lines[way].valid && lines[way].tag == tag) {
+      int cycles = cache->coherence ? APEX_coherence_hit(cache, line, is_write) : 0;
+      touch(cache, set, way);
+      if (cycles >= 0) {
+        cache->hits++;
+        lines[way].dirty |= is_write && cache->write_back;
+        return cycles;
+      }
+      /* Another core took the line away, fetch it again into the same way */
+      cache->misses++;
+      cache->coherence_misses++;
+      lines[way].dirty = is_write;
+      return cache->miss_penalty + APEX_coherence_fill(cache, line, is_write);
+    }
+  }
+
+  cache->misses++;
+  if (is_write && !cache->write_back) {
+    return 0;
+  }
+  int way = victim(cache, set);
+  int cycles = cache->miss_penalty;
+  if (lines[way].valid) {
+    cache->evictions++;
+    if (cache->coherence ? APEX_coherence_evict(cache, lines[way].tag * cache->sets + set) : lines[way].dirty) {
+      cache->writebacks++;
+      cycles += cache->miss_penalty;
+    }
+  }
+  lines[way].valid = 1;
+  lines[way].tag = tag;
+  lines[way].dirty = is_write;
+  touch(cache, set, way);
+  if (cache->coherence) {
+    cycles += APEX_coherence_fill(cache, line, is_write);
+  }
+  return cycles;
+}
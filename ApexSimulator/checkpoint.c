@@ -0,0 +1,275 @@
+/*
+ *  checkpoint.c
+ *  Contains functions to save the complete state of an APEX cpu to a
+ *  binary file and to restore it
+ *
+ *  File layout, every section 64 byte aligned:
+ *
+ *    APEX_CheckpointHeader
+ *    code memory   (code_memory_size APEX_Instruction entries)
+ *    APEX_CPU      (registers, latches, scoreboard, clock, PC, stats;
+ *                   pointers are stored as 0)
+ *    data memory   (num_pages APEX_MemoryPage entries, in address order)
+ *
+ *  The file is memory-mapped on load. The code memory of a restored cpu
+ *  points straight into the read-only mapping, so every cpu restored from
+ *  the same checkpoint shares those pages; the rest of the state is
+ *  copied into a private APEX_CPU, and the data memory pages into pages
+ *  of its own.
+ */
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+#define CHECKPOINT_MAGIC "APEXCKPT"
+
+/* Bump whenever APEX_CPU, CPU_Stage or APEX_Instruction change layout */
+#define CHECKPOINT_VERSION 18
+
+typedef struct APEX_CheckpointHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t cpu_size;          // sizeof(APEX_CPU) of the writer
+  uint32_t instruction_size;  // sizeof(APEX_Instruction) of the writer
+  uint32_t code_memory_size;  // Number of instructions
+  uint64_t code_offset;
+  uint64_t cpu_offset;
+  uint64_t pages_offset;
+  uint32_t num_pages;         // Data memory pages a store has touched
+  uint32_t page_size;         // sizeof(APEX_MemoryPage) of the writer
+} APEX_CheckpointHeader;
+
+static uint64_t
+align_up(uint64_t offset)
+{
+  return (offset + 63) & ~(uint64_t) 63;
+}
+
+static int
+write_at(FILE* fp, uint64_t offset, const void* data, size_t size)
+{
+  if (fseek(fp, offset, SEEK_SET) != 0) {
+    return -1;
+  }
+  return fwrite(data, 1, size, fp) == size ? 0 : -1;
+}
+
+/*
+ * Returns 1 if path starts like a checkpoint file, whatever its version
+ */
+int
+APEX_is_checkpoint(const char* path)
+{
+  char magic[8];
+  FILE* fp = fopen(path, "rb");
+  if (!fp) {
+    return 0;
+  }
+  int is_checkpoint = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                      memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0;
+  fclose(fp);
+  return is_checkpoint;
+}
+
+/*
+ * Writes the cpu state and its code memory to path.
+ * Returns 0 on success, -1 on failure.
+ */
+int
+APEX_cpu_save(const APEX_CPU* cpu, const char* path)
+{
+  APEX_CheckpointHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.version = CHECKPOINT_VERSION;
+  header.cpu_size = sizeof(APEX_CPU);
+  header.instruction_size = sizeof(APEX_Instruction);
+  header.code_memory_size = cpu->code_memory_size;
+  header.code_offset = align_up(sizeof(header));
+  header.cpu_offset = align_up(header.code_offset + sizeof(APEX_Instruction) * cpu->code_memory_size);
+  header.pages_offset = align_up(header.cpu_offset + sizeof(APEX_CPU));
+  header.page_size = sizeof(APEX_MemoryPage);
+
+  /* Host pointers mean nothing in another process */
+  APEX_CPU* state = malloc(sizeof(*state));
+  if (!state) {
+    return -1;
+  }
+  memcpy(state, cpu, sizeof(*state));
+  state->code_memory = NULL;
+  state->owns_code_memory = 0;
+  state->checkpoint_mapping = NULL;
+  state->checkpoint_mapping_size = 0;
+  state->trace = NULL;
+  state->translation = NULL;
+  state->dcache.coherence = NULL;
+  memset(&state->data_memory, 0, sizeof(state->data_memory));
+  APEX_MemoryPage** pages = APEX_memory_sorted_pages(&cpu->data_memory, &header.num_pages);
+  if (header.num_pages && !pages) {
+    free(state);
+    return -1;
+  }
+
+  FILE* fp = fopen(path, "wb");
+  int result = -1;
+  if (fp) {
+    result = write_at(fp, 0, &header, sizeof(header));
+    if (result == 0) {
+      result = write_at(fp, header.code_offset, cpu->code_memory, sizeof(APEX_Instruction) * cpu->code_memory_size);
+    }
+    if (result == 0) {
+      result = write_at(fp, header.cpu_offset, state, sizeof(*state));
+    }
+    for (uint32_t i = 0; result == 0 && i < header.num_pages; ++i) {
+      result = write_at(fp, header.pages_offset + (uint64_t) i * sizeof(APEX_MemoryPage), pages[i], sizeof(APEX_MemoryPage));
+    }
+    if (fclose(fp) != 0) {
+      result = -1;
+    }
+  }
+  free(pages);
+  free(state);
+  return result;
+}
+
+/*
+ * Returns 1 if count entries of size bytes at offset, 64 byte aligned,
+ * lie inside a mapping of mapping_size bytes. Written so that no sum of
+ * fields read from the file can wrap.
+ */
+static int
+section_fits(uint64_t offset, uint64_t count, uint64_t size, size_t mapping_size)
+{
+  return offset % 64 == 0 && offset <= mapping_size && count <= (mapping_size - offset) / size;
+}
+
+/*
+ * Returns 1 if the restored state of cpu, its code memory already in
+ * place, only holds values the simulator could have produced: the
+ * fields used as array indices or bounds are checked the way the
+ * configure functions check a spec.
+ */
+static int
+state_valid(const APEX_CPU* cpu)
+{
+  if (cpu->hazard_policy < 0 || cpu->hazard_policy >= NUM_HAZARD_POLICIES ||
+      cpu->width < 1 || cpu->width > APEX_MAX_WIDTH || cpu->pc < 4000 || cpu->pc % 4 != 0 ||
+      (cpu->flush_and_reload_pc && (cpu->flush_and_reload_pc < 4000 || cpu->flush_and_reload_pc % 4 != 0))) {
+    return 0;
+  }
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    const APEX_Unit* timing = &cpu->units[unit];
+    if (timing->latency < 1 || timing->latency > UINT16_MAX || timing->interval < 1 || timing->interval > timing->latency) {
+      return 0;
+    }
+  }
+  for (int s = 0; s < NUM_STAGES; ++s) {
+    if (cpu->stage[s][0].count > cpu->width) {
+      return 0;
+    }
+    for (int i = 0; i < APEX_MAX_WIDTH; ++i) {
+      if (!APEX_stage_valid(&cpu->stage[s][i])) {
+        return 0;
+      }
+    }
+  }
+  return APEX_bpred_valid(&cpu->bpred, cpu->code_memory_size) &&
+         APEX_cache_valid(&cpu->icache) && APEX_cache_valid(&cpu->dcache) &&
+         APEX_ooo_valid(cpu);
+}
+
+/*
+ * Restores a cpu saved by APEX_cpu_save.
+ * Returns NULL if path is not a checkpoint written by this build.
+ */
+APEX_CPU*
+APEX_cpu_load(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(APEX_CheckpointHeader)) {
+    close(fd);
+    return NULL;
+  }
+  size_t mapping_size = st.st_size;
+  char* mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+
+  const APEX_CheckpointHeader* header = (const APEX_CheckpointHeader*) mapping;
+  if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != CHECKPOINT_VERSION ||
+      header->cpu_size != sizeof(APEX_CPU) ||
+      header->instruction_size != sizeof(APEX_Instruction) ||
+      header->page_size != sizeof(APEX_MemoryPage) ||
+      header->code_memory_size > INT_MAX ||
+      !section_fits(header->code_offset, header->code_memory_size, sizeof(APEX_Instruction), mapping_size) ||
+      !section_fits(header->cpu_offset, 1, sizeof(APEX_CPU), mapping_size) ||
+      (header->num_pages && !section_fits(header->pages_offset, header->num_pages, sizeof(APEX_MemoryPage), mapping_size))) {
+    fprintf(stderr, "APEX_Error : %s was not written by this build of the simulator\n", path);
+    munmap(mapping, mapping_size);
+    return NULL;
+  }
+  if (!APEX_code_memory_valid((const APEX_Instruction*) (mapping + header->code_offset), header->code_memory_size)) {
+    fprintf(stderr, "APEX_Error : %s holds a corrupt code memory\n", path);
+    munmap(mapping, mapping_size);
+    return NULL;
+  }
+
+  APEX_CPU* cpu = malloc(sizeof(*cpu));
+  if (!cpu) {
+    munmap(mapping, mapping_size);
+    return NULL;
+  }
+  memcpy(cpu, mapping + header->cpu_offset, sizeof(*cpu));
+  /* Pointers of the file are never followed, whatever it holds */
+  cpu->code_memory = (const APEX_Instruction*) (mapping + header->code_offset);
+  cpu->code_memory_size = header->code_memory_size;
+  cpu->owns_code_memory = 0;
+  cpu->checkpoint_mapping = mapping;
+  cpu->checkpoint_mapping_size = mapping_size;
+  cpu->trace = NULL;
+  cpu->translation = NULL;
+  cpu->icache.coherence = NULL;
+  cpu->dcache.coherence = NULL;
+  memset(&cpu->data_memory, 0, sizeof(cpu->data_memory));
+  if (!state_valid(cpu)) {
+    fprintf(stderr, "APEX_Error : %s holds a corrupt cpu state\n", path);
+    APEX_cpu_stop(cpu);
+    return NULL;
+  }
+
+  /* APEX_cpu_save writes every page once, in address order */
+  const APEX_MemoryPage* pages = (const APEX_MemoryPage*) (mapping + header->pages_offset);
+  for (uint32_t i = 0; i < header->num_pages; ++i) {
+    if (pages[i].number >= APEX_NUM_PAGES || (i && pages[i].number <= pages[i - 1].number)) {
+      fprintf(stderr, "APEX_Error : %s holds a corrupt data memory\n", path);
+      APEX_cpu_stop(cpu);
+      return NULL;
+    }
+    APEX_MemoryPage* page = APEX_memory_page(&cpu->data_memory, pages[i].number, 1);
+    memcpy(page->words, pages[i].words, sizeof(page->words));
+  }
+  /* Resume with the saved hazard policy, which a specialized build must have */
+  int policy = cpu->hazard_policy;
+  if (APEX_cpu_set_hazard_policy(cpu, policy) != 0) {
+    fprintf(stderr, "APEX_Error : %s was saved under hazard policy %s, not available in this build\n", path,
+            hazard_policy_names[policy]);
+    APEX_cpu_stop(cpu);
+    return NULL;
+  }
+  return cpu;
+}
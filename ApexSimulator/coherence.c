@@ -0,0 +1,161 @@
+/*
+ *  coherence.c
+ *  Contains the MESI directory that keeps the L1 data caches of a
+ *  multi-core system coherent
+ *
+ *  Every line held by some L1 has a state word in the directory: the mask
+ *  of the cores sharing it and whether the one core holding it has
+ *  modified it. The MESI state of a line in the L1 of core c reads as
+ *
+ *    M   c alone in the mask, modified
+ *    E   c alone in the mask, clean
+ *    S   c and others in the mask, clean
+ *    I   c not in the mask, or no tag for it in the L1
+ *
+ *  A core changes a state word with compare-and-swap, so the cores, each
+ *  on a host thread of its own, keep their L1s coherent without a lock.
+ *  A write takes the line away from the other cores by clearing their
+ *  bits; their tags stay until they touch the line again and take a
+ *  coherence miss. Like the caches, the directory only decides timing,
+ *  the cores all read and write the shared data memory.
+ *
+ *  Every bus transaction costs the miss_penalty of the L1 that needs it:
+ *  a fill, the upgrade of a shared line for a write, and the write back
+ *  of a modified line, evicted or wanted by another core.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+
+/* Set in the state word of a line its single sharer has written to */
+#define MODIFIED (1ull << 32)
+
+/* State words are allocated in chunks of this many lines */
+#define CHUNK_BITS 12
+#define NUM_CHUNKS (1u << (32 - CHUNK_BITS))
+
+typedef struct APEX_Coherence
+{
+  uint64_t** chunks; // NUM_CHUNKS entries, NULL until a line of the chunk is filled
+} APEX_Coherence;
+
+APEX_Coherence*
+APEX_coherence_create(void)
+{
+  APEX_Coherence* coherence = malloc(sizeof(*coherence));
+  if (!coherence) {
+    return NULL;
+  }
+  /* Virtual memory the host only backs where chunks are installed */
+  coherence->chunks = calloc(NUM_CHUNKS, sizeof(*coherence->chunks));
+  if (!coherence->chunks) {
+    free(coherence);
+    return NULL;
+  }
+  return coherence;
+}
+
+void
+APEX_coherence_free(APEX_Coherence* coherence)
+{
+  if (!coherence) {
+    return;
+  }
+  for (uint32_t chunk = 0; chunk < NUM_CHUNKS; ++chunk) {
+    free(coherence->chunks[chunk]);
+  }
+  free(coherence->chunks);
+  free(coherence);
+}
+
+/* State word of line, its chunk is installed by the first core to need it */
+static uint64_t*
+state_of(APEX_Coherence* coherence, uint32_t line)
+{
+  uint64_t** slot = &coherence->chunks[line >> CHUNK_BITS];
+  uint64_t* chunk = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  if (!chunk) {
+    chunk = calloc(1 << CHUNK_BITS, sizeof(*chunk));
+    if (!chunk) {
+      fprintf(stderr, "APEX_Error : Out of memory for the coherence directory\n");
+      exit(1);
+    }
+    uint64_t* expected = NULL;
+    if (!__atomic_compare_exchange_n(slot, &expected, chunk, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      free(chunk);
+      chunk = expected;
+    }
+  }
+  return &chunk[line & ((1 << CHUNK_BITS) - 1)];
+}
+
+/*
+ * Access of cache to line, whose tag it holds. Returns -1 if another
+ * core has invalidated the copy, otherwise the cycles beyond a hit: an
+ * upgrade for a write to a shared line, nothing for E and M.
+ */
+int
+APEX_coherence_hit(APEX_Cache* cache, uint32_t line, int is_write)
+{
+  uint64_t* state = state_of(cache->coherence, line);
+  uint64_t bit = 1ull << cache->core;
+  uint64_t old = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+  for (;;) {
+    if (!(old & bit)) {
+      return -1;
+    }
+    if (!is_write || old == (bit | MODIFIED)) {
+      return 0;
+    }
+    /* E turns into M silently, S invalidates the other copies first */
+    if (__atomic_compare_exchange_n(state, &old, bit | MODIFIED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      if (old == bit) {
+        return 0;
+      }
+      cache->upgrades++;
+      return cache->miss_penalty;
+    }
+  }
+}
+
+/*
+ * Fill of line into cache for a read (to E or S) or a write (to M).
+ * Returns the cycles beyond the fill itself: those of the core that had
+ * modified the line writing it back first.
+ */
+int
+APEX_coherence_fill(APEX_Cache* cache, uint32_t line, int is_write)
+{
+  uint64_t* state = state_of(cache->coherence, line);
+  uint64_t bit = 1ull << cache->core;
+  uint64_t old = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+  uint64_t new;
+  do {
+    new = is_write ? bit | MODIFIED : (old | bit) & ~MODIFIED;
+  } while (!__atomic_compare_exchange_n(state, &old, new, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  if (old & MODIFIED) {
+    cache->interventions++;
+    return cache->miss_penalty;
+  }
+  return 0;
+}
+
+/*
+ * Eviction of line from cache. Returns 1 if cache had modified the line,
+ * which is then written back.
+ */
+int
+APEX_coherence_evict(APEX_Cache* cache, uint32_t line)
+{
+  uint64_t* state = state_of(cache->coherence, line);
+  uint64_t bit = 1ull << cache->core;
+  uint64_t old = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+  do {
+    /* Already invalidated, the line is another core's business */
+    if (!(old & bit)) {
+      return 0;
+    }
+  } while (!__atomic_compare_exchange_n(state, &old, old & ~(bit | MODIFIED), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+  return (old & MODIFIED) != 0;
+}
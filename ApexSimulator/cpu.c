@@ -0,0 +1,1419 @@
+/*
+ *  cpu.c
+ *  Contains APEX cpu pipeline implementation
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cpu.h"
+
+/* Compile with -DAPEX_HAZARD_POLICY=HAZARD_* for a pipeline specialized for
+ * one hazard policy: every policy test below is then a constant and the
+ * other policies' code is dropped. Without it the policy is read from the
+ * cpu, so one binary can switch between them. */
+#ifdef APEX_HAZARD_POLICY
+#define HAZARD_POLICY(cpu) (APEX_HAZARD_POLICY)
+#define DEFAULT_HAZARD_POLICY APEX_HAZARD_POLICY
+#else
+#define HAZARD_POLICY(cpu) ((cpu)->hazard_policy)
+#define DEFAULT_HAZARD_POLICY HAZARD_INTERLOCK
+#endif
+
+const char* const hazard_policy_names[NUM_HAZARD_POLICIES] = {
+  [HAZARD_INTERLOCK] = "interlock",
+  [HAZARD_FORWARD] = "forward",
+  [HAZARD_FORWARD_LOAD_STALL] = "forward_lu",
+};
+
+/* Returns the HAZARD_* policy called name, -1 if there is none */
+int
+APEX_hazard_policy_from_name(const char* name)
+{
+  for (int policy = 0; policy < NUM_HAZARD_POLICIES; ++policy) {
+    if (strcmp(hazard_policy_names[policy], name) == 0) {
+      return policy;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Selects the hazard policy of decode. A specialized build always keeps
+ * its own policy and returns -1 if asked for another one.
+ */
+int
+APEX_cpu_set_hazard_policy(APEX_CPU* cpu, int policy)
+{
+#ifdef APEX_HAZARD_POLICY
+  cpu->hazard_policy = APEX_HAZARD_POLICY;
+  return policy == APEX_HAZARD_POLICY ? 0 : -1;
+#else
+  if (policy < 0 || policy >= NUM_HAZARD_POLICIES) {
+    return -1;
+  }
+  cpu->hazard_policy = policy;
+  return 0;
+#endif
+}
+
+/*
+ * Sets how many instructions fetch, decode and the execute stages
+ * handle per cycle. Returns -1 if width is not between 1 and
+ * APEX_MAX_WIDTH.
+ */
+int
+APEX_cpu_set_width(APEX_CPU* cpu, int width)
+{
+  if (width < 1 || width > APEX_MAX_WIDTH) {
+    return -1;
+  }
+  cpu->width = width;
+  return 0;
+}
+
+const char* const unit_names[NUM_UNITS] = {
+  [UNIT_ALU] = "alu",
+  [UNIT_MUL] = "mul",
+  [UNIT_MEM] = "mem",
+};
+
+/*
+ * Sets the timing of a functional unit in units from
+ * "<unit>:<latency>[:<interval>]",
+ * e.g. "mul:4" for a pipelined and "mul:4:4" for a blocking multiplier.
+ * The interval defaults to 1. Returns -1 if spec is not valid.
+ */
+int
+APEX_set_unit(APEX_Unit units[NUM_UNITS], const char* spec)
+{
+  const char* colon = strchr(spec, ':');
+  if (!colon) {
+    return -1;
+  }
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    if (strlen(unit_names[unit]) != (size_t) (colon - spec) ||
+        strncmp(unit_names[unit], spec, colon - spec) != 0) {
+      continue;
+    }
+    char* end;
+    long latency = strtol(colon + 1, &end, 0);
+    long interval = 1;
+    if (*end == ':') {
+      interval = strtol(end + 1, &end, 0);
+    }
+    /* Bounded so that cycle numbers computed from them stay far from overflowing */
+    if (*end || latency < 1 || interval < 1 || interval > latency || latency > UINT16_MAX) {
+      return -1;
+    }
+    units[unit].latency = latency;
+    units[unit].interval = interval;
+    return 0;
+  }
+  return -1;
+}
+
+/*
+ * This function creates an APEX cpu on top of an already parsed program.
+ * The code memory is only read, so any number of cpus can share it; it
+ * stays owned by the caller.
+ */
+APEX_CPU*
+APEX_cpu_create(const APEX_Instruction* code_memory, int code_memory_size)
+{
+  if (!code_memory) {
+    return NULL;
+  }
+
+  APEX_CPU* cpu = calloc(1, sizeof(*cpu));
+  if (!cpu) {
+    return NULL;
+  }
+
+  /* Initialize PC, Registers and all pipeline stages */
+  cpu->pc = 4000;
+  memset(cpu->regs, 0, sizeof(int) * 17);
+  memset(cpu->regs_valid, 1, sizeof(cpu->regs_valid));
+  memset(cpu->stage, 0, sizeof(cpu->stage));
+
+  cpu->code_memory = code_memory;
+  cpu->code_memory_size = code_memory_size;
+  cpu->enable_debug_messages = 1;
+  cpu->hazard_policy = DEFAULT_HAZARD_POLICY;
+  cpu->width = 1;
+  cpu->jit_threshold = APEX_JIT_THRESHOLD;
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    cpu->units[unit].latency = 1;
+    cpu->units[unit].interval = 1;
+  }
+
+  /* Make all stages busy except Fetch stage by setting their pc value to 0, initally to start the pipeline */
+  for (int i = 1; i < NUM_STAGES; ++i) {
+    cpu->stage[i]->pc = 0;
+  }
+
+  return cpu;
+}
+
+/*
+ * This function creates and initializes APEX cpu. The program is loaded
+ * through the image cache in cache_dir unless it is NULL.
+ *
+ * Note : You are free to edit this function according to your
+ * 				implementation
+ */
+APEX_CPU*
+APEX_cpu_init(const char* filename, const char* cache_dir)
+{
+  if (!filename) {
+    return NULL;
+  }
+
+  /* Parse input file and create code memory */
+  int code_memory_size = 0;
+  APEX_Instruction* code_memory = APEX_load_program(filename, cache_dir, &code_memory_size);
+  APEX_CPU* cpu = APEX_cpu_create(code_memory, code_memory_size);
+
+  if (!cpu) {
+    free(code_memory);
+    return NULL;
+  }
+  cpu->owns_code_memory = 1;
+
+  if (cpu->enable_debug_messages) {
+    fprintf(stderr,
+            "APEX_CPU : Initialized APEX CPU, loaded %d instructions\n",
+            cpu->code_memory_size);
+    fprintf(stderr, "APEX_CPU : Printing Code Memory\n");
+    printf("%-9s %-9s %-9s %-9s %-9s %-9s\n", "opcode", "rd", "rs1", "rs2", "rs3", "imm");
+
+    for (int i = 0; i < cpu->code_memory_size; ++i) {
+      printf("%-9s %-9d %-9d %-9d %-9d %-9d\n",
+             opcode_info[cpu->code_memory[i].op].name,
+             cpu->code_memory[i].rd,
+             cpu->code_memory[i].rs1,
+             cpu->code_memory[i].rs2,
+             cpu->code_memory[i].rs3,
+             cpu->code_memory[i].imm);
+    }
+  }
+
+  return cpu;
+}
+
+/*
+ * This function de-allocates APEX cpu.
+ *
+ * Note : You are free to edit this function according to your
+ * 				implementation
+ */
+void
+APEX_cpu_stop(APEX_CPU* cpu)
+{
+  if (cpu->owns_code_memory) {
+    free((APEX_Instruction*) cpu->code_memory);
+  }
+  if (cpu->checkpoint_mapping) {
+    munmap(cpu->checkpoint_mapping, cpu->checkpoint_mapping_size);
+  }
+  APEX_memory_free(&cpu->data_memory);
+  APEX_translation_free(cpu->translation);
+  free(cpu);
+}
+
+/* Converts the PC(4000 series) into
+ * array index for code memory
+ *
+ * Note : You are not supposed to edit this function
+ *
+ */
+int
+get_code_index(int pc)
+{
+  return (pc - 4000) / 4;
+}
+
+/*
+ * Returns 1 if a latch restored from outside this run, e.g. from a
+ * checkpoint, holds an opcode and registers the stages can index
+ * opcode_info and the register file with.
+ */
+int
+APEX_stage_valid(const CPU_Stage* stage)
+{
+  return APEX_operands_valid(stage->op, stage->op_flags, stage->rd, stage->rs1, stage->rs2, stage->rs3) &&
+         stage->count <= APEX_MAX_WIDTH;
+}
+
+/* Fetched in place of code memory once the PC runs past the last instruction */
+static const APEX_Instruction end_of_program = {
+  .imm = -1, .op = OP_NONE, .rd = -1, .rs1 = -1, .rs2 = -1, .rs3 = -1
+};
+
+/* Returns 1 while the instruction held in this latch has not yet been
+ * processed by stage s. Progress is tracked per dynamic instance through
+ * the sequence number fetch gives it, so the same static instruction can
+ * be in flight more than once.
+ */
+static int
+is_pending(const APEX_CPU* cpu, const CPU_Stage* latch, int s)
+{
+  return latch->pc >= 4000 && latch->seq > cpu->stage_seq[s];
+}
+
+static void
+print_instruction(CPU_Stage* stage)
+{
+  const char* name = opcode_info[stage->op].name;
+  switch (stage->op) {
+  case OP_STORE:
+    printf("%s,R%d,R%d,#%d ", name, stage->rs1, stage->rs2, stage->imm);
+    break;
+  case OP_MOVC:
+    printf("%s,R%d,#%d ", name, stage->rd, stage->imm);
+    break;
+  case OP_ADD:
+  case OP_SUB:
+  case OP_MUL:
+  case OP_LDR:
+  case OP_AND:
+  case OP_OR:
+  case OP_EXOR:
+    printf("%s,R%d,R%d,R%d ", name, stage->rd, stage->rs1, stage->rs2);
+    break;
+  case OP_LOAD:
+  case OP_ADDL:
+  case OP_SUBL:
+    printf("%s,R%d,R%d,#%d ", name, stage->rd, stage->rs1, stage->imm);
+    break;
+  case OP_STR:
+    printf("%s,R%d,R%d,R%d ", name, stage->rs1, stage->rs2, stage->rs3);
+    break;
+  case OP_BZ:
+  case OP_BNZ:
+    printf("%s,#%d", name, stage->imm);
+    break;
+  case OP_JUMP:
+    printf("%s,R%d,#%d ", name, stage->rs1, stage->imm);
+    break;
+  case OP_HALT:
+    printf("%s", name);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Debug function which dumps the cpu stage
+ * content
+ *
+ * Note : You are not supposed to edit this function
+ *
+ */
+void
+print_stage_content(const char* name, CPU_Stage* stage, int is_active)
+{
+  printf("%-15s ", name);
+  if(is_active) {
+    printf("(I%d: %d) ", get_code_index(stage->pc), stage->pc);
+    print_instruction(stage);
+  } else {
+    printf("EMPTY");
+  }
+  printf("\n");
+}
+
+/* Name printed in front of each stage by print_stage_content */
+const char* const stage_names[NUM_STAGES] = {
+  [F] = "Instruction at FETCH_____STAGE--->\t",
+  [DRF] = "Instruction at DECODE_RF_STAGE--->\t",
+  [EX1] = "Instruction at EX1_______STAGE--->\t",
+  [EX2] = "Instruction at EX2_______STAGE--->\t",
+  [MEM1] = "Instruction at MEMORY1___STAGE--->\t",
+  [MEM2] = "Instruction at MEMORY2___STAGE--->\t",
+  [WB] = "Instruction at WRITEBACK_STAGE--->\t",
+};
+
+/* Fills sources with the registers decode reads for stage, -1 where unused */
+static inline void
+decode_sources(const CPU_Stage* stage, int sources[3])
+{
+  if (stage->op == OP_BZ || stage->op == OP_BNZ) {
+    sources[0] = CC;
+    sources[1] = sources[2] = -1;
+    return;
+  }
+  sources[0] = (stage->op_flags & OPF_RS1) ? stage->rs1 : -1;
+  sources[1] = (stage->op_flags & OPF_RS2) ? stage->rs2 : -1;
+  sources[2] = (stage->op_flags & OPF_RS3) ? stage->rs3 : -1;
+}
+
+/* Returns 1 if decode cannot read the register producer writes yet */
+static inline int
+waits_on(const APEX_CPU* cpu, const APEX_Producer* producer)
+{
+  return producer->seq && (HAZARD_POLICY(cpu) == HAZARD_INTERLOCK || cpu->clock < producer->ready);
+}
+
+/* Returns 1 while stage s holds a group it has not passed on */
+static inline int
+occupied(const APEX_CPU* cpu, int s)
+{
+  return cpu->stage[s]->busy || is_pending(cpu, cpu->stage[s], s);
+}
+
+/* Number of instructions in the group that starts at latch */
+static inline int
+lanes(const CPU_Stage* group)
+{
+  return group->count ? group->count : 1;
+}
+
+/* Copies the group stage from holds into the latch of stage to */
+static inline void
+pass_group(APEX_CPU* cpu, int from, int to)
+{
+  memcpy(cpu->stage[to], cpu->stage[from], lanes(cpu->stage[from]) * sizeof(CPU_Stage));
+}
+
+/* Returns 1 if the last instruction of the group is a branch */
+static inline int
+ends_in_branch(const CPU_Stage* group)
+{
+  return (group[lanes(group) - 1].op_flags & OPF_BRANCH) != 0;
+}
+
+/*
+ * Returns the counter a decode stall cycle is charged to: CC, LOAD-use or
+ * plain RAW dependencies, or EX1 still holding an earlier instruction
+ */
+static long*
+decode_stall_counter(APEX_CPU* cpu, const CPU_Stage* stage)
+{
+  int sources[3];
+  decode_sources(stage, sources);
+  long* counter = &cpu->stats.stall_structural;
+  for (int i = 0; i < 3; ++i) {
+    const APEX_Producer* producer = sources[i] >= 0 ? &cpu->scoreboard[sources[i]] : NULL;
+    if (producer && waits_on(cpu, producer)) {
+      if (sources[i] == CC) {
+        return &cpu->stats.stall_cc;
+      }
+      if (producer->is_load && cpu->clock < producer->ready) {
+        return &cpu->stats.stall_load_use;
+      }
+      counter = &cpu->stats.stall_raw;
+    }
+  }
+  return counter;
+}
+
+/*
+ * Returns the first cycle at which EX1 may take the instruction a stalled
+ * decode holds, or one of the operands it waits on may become ready.
+ * Until then every cycle repeats the same stall, charged to the same
+ * counter. Returns 0 if that cannot be told.
+ */
+static int
+decode_ready_at(const APEX_CPU* cpu, const CPU_Stage* stage)
+{
+  int sources[3];
+  decode_sources(stage, sources);
+  int ready = INT_MAX;
+  if (occupied(cpu, EX1)) {
+    /* A held EX1 passes its instruction on once busy runs out */
+    ready = cpu->clock + cpu->stage[EX1]->busy;
+  }
+  for (int i = 0; i < 3; ++i) {
+    const APEX_Producer* producer = sources[i] >= 0 ? &cpu->scoreboard[sources[i]] : NULL;
+    if (producer && waits_on(cpu, producer)) {
+      /* A LOAD still on its way to MEM2 gets there no sooner than this */
+      int at = producer->ready == INT_MAX ? producer->executed + (MEM2 - EX1) : producer->ready;
+      if (at < ready) {
+        ready = at;
+      }
+    }
+  }
+  return ready == INT_MAX || ready <= cpu->clock ? 0 : ready;
+}
+
+/* Returns the last cycle in which a functional unit computes a result of the group, INT_MIN if none */
+static inline int
+result_done(const CPU_Stage* group)
+{
+  int done = INT_MIN;
+  for (int lane = 0; lane < lanes(group); ++lane) {
+    if ((group[lane].op_flags & OPF_RD) && group[lane].done > done) {
+      done = group[lane].done;
+    }
+  }
+  return done;
+}
+
+/* Returns 1 if writeback has to wait for a result the group carries */
+static inline int
+result_pending(const APEX_CPU* cpu, const CPU_Stage* group)
+{
+  return cpu->clock <= result_done(group);
+}
+
+/*
+ * Returns the first cycle before which no latch can change, other than by
+ * the count down of fetch waiting for the I-cache and of the stages
+ * holding an instruction for their functional unit, and the repeated
+ * stall of a decode waiting for decode_wakeup. Returns the current cycle
+ * if something happens in it.
+ */
+static int
+quiet_until(const APEX_CPU* cpu)
+{
+  /* Decode has nothing to do at all until fetch hands it an instruction */
+  int until = is_pending(cpu, cpu->stage[DRF], DRF) ? cpu->decode_wakeup : INT_MAX;
+  if (cpu->stage[F]->busy) {
+    /* Fetch has the line once busy runs out */
+    if (cpu->clock + cpu->stage[F]->busy < until) {
+      until = cpu->clock + cpu->stage[F]->busy;
+    }
+  } else if (!is_pending(cpu, cpu->stage[DRF], DRF)) {
+    return cpu->clock;
+  }
+  for (int s = EX1; s <= WB; ++s) {
+    const CPU_Stage* latch = cpu->stage[s];
+    int event;
+    if (latch->busy > 1) {
+      event = cpu->clock + latch->busy - 1;
+    } else if (s == WB && is_pending(cpu, latch, WB) && result_pending(cpu, latch)) {
+      event = result_done(latch) + 1;
+    } else if (s < WB && (latch->busy || s == EX2 || s == MEM2) && occupied(cpu, s + 1)) {
+      /* Held back until stage s + 1 moves on, which is an event of its own */
+      continue;
+    } else if (occupied(cpu, s)) {
+      return cpu->clock;
+    } else {
+      continue;
+    }
+    if (event < until) {
+      until = event;
+    }
+  }
+  return until;
+}
+
+/* Returns 1 if the latch holds an instruction that writes register r, CC included */
+static inline int
+writes_register(const CPU_Stage* latch, int r)
+{
+  return r == CC ? (latch->op_flags & OPF_SETS_CC) != 0
+                 : (latch->op_flags & OPF_RD) && latch->rd == r;
+}
+
+/*
+ * Makes the instruction in latch the producer of register r. It leaves
+ * EX1 in cycle executed, and its functional unit computes the result in
+ * cycle latch->done. That result can be forwarded from then on under
+ * HAZARD_FORWARD and one cycle later under HAZARD_FORWARD_LOAD_STALL. The
+ * value of a LOAD or LDR is only known once MEM2 has read the data
+ * memory, see load_arrived. Under HAZARD_INTERLOCK a result is never
+ * forwarded, and ready is only the earliest cycle it can be written back.
+ */
+static void
+set_producer(APEX_CPU* cpu, int r, const CPU_Stage* latch, int executed)
+{
+  APEX_Producer* producer = &cpu->scoreboard[r];
+  producer->seq = latch->seq;
+  producer->executed = executed;
+  producer->is_load = r != CC && (latch->op_flags & OPF_LOAD);
+  producer->value = r == CC ? (latch->buffer == 0) : latch->buffer;
+  if (producer->is_load) {
+    producer->ready = INT_MAX;
+  } else if (HAZARD_POLICY(cpu) == HAZARD_INTERLOCK) {
+    int written = executed + (WB - EX1);
+    producer->ready = written > latch->done ? written : latch->done + 1;
+  } else {
+    producer->ready = latch->done + (HAZARD_POLICY(cpu) == HAZARD_FORWARD_LOAD_STALL);
+  }
+}
+
+/* MEM2 has read the value of the LOAD or LDR in latch */
+static void
+load_arrived(APEX_CPU* cpu, const CPU_Stage* latch)
+{
+  APEX_Producer* producer = &cpu->scoreboard[latch->rd];
+  if (producer->seq != latch->seq) {
+    return;
+  }
+  producer->value = latch->buffer;
+  if (HAZARD_POLICY(cpu) == HAZARD_INTERLOCK) {
+    producer->ready = cpu->clock < latch->done ? latch->done + 1 : cpu->clock + 1;
+  } else {
+    producer->ready = latch->done;
+  }
+}
+
+/*
+ * Undoes the scoreboard entries of a group that has been through EX1
+ * before a flush squashes it: each register one of its instructions
+ * claimed goes back to its youngest surviving producer, if there is one
+ */
+static void
+squash_producer(APEX_CPU* cpu, const CPU_Stage* group)
+{
+  for (int lane = 0; lane < lanes(group); ++lane) {
+    const CPU_Stage* squashed = &group[lane];
+    int claimed[2] = { (squashed->op_flags & OPF_RD) ? squashed->rd : -1,
+                       (squashed->op_flags & OPF_SETS_CC) ? CC : -1 };
+    for (int i = 0; i < 2; ++i) {
+      int r = claimed[i];
+      if (r < 0 || cpu->scoreboard[r].seq != squashed->seq) {
+        continue;
+      }
+      cpu->scoreboard[r].seq = 0;
+      /* Oldest first, so that the youngest survivor is left in the entry */
+      for (int s = WB; s >= MEM1; --s) {
+        if (!occupied(cpu, s)) {
+          continue;
+        }
+        for (int j = 0; j < lanes(cpu->stage[s]); ++j) {
+          const CPU_Stage* survivor = &cpu->stage[s][j];
+          if (writes_register(survivor, r)) {
+            set_producer(cpu, r, survivor, cpu->clock - (s - EX2));
+            if (s == WB && (survivor->op_flags & OPF_LOAD) && r != CC) {
+              load_arrived(cpu, survivor);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Undoes the scoreboard entries of whatever EX1 has executed and EX2 not yet processed */
+static void
+squash_executed(APEX_CPU* cpu)
+{
+  if (cpu->stage[EX1]->busy) {
+    squash_producer(cpu, cpu->stage[EX1]);
+  } else if (is_pending(cpu, cpu->stage[EX2], EX2)) {
+    squash_producer(cpu, cpu->stage[EX2]);
+  }
+}
+
+/*
+ * Reads source register r for decode into *value, from the register file
+ * or, if its producer is still in flight and the hazard policy allows it,
+ * from the scoreboard; forwarded counts the operands taken from each
+ * stage. Returns 0 if decode has to stall because the value is not
+ * available yet.
+ */
+static inline int
+read_source(APEX_CPU* cpu, int r, int* value, int* forwarded)
+{
+  const APEX_Producer* producer = &cpu->scoreboard[r];
+  if (!producer->seq) {
+    *value = cpu->regs[r];
+    return 1;
+  }
+  if (HAZARD_POLICY(cpu) == HAZARD_INTERLOCK || cpu->clock < producer->ready) {
+    return 0;
+  }
+  *value = producer->value;
+  /* Stage the result left this cycle, a late one counts as MEM2 */
+  int from = EX1 + cpu->clock - producer->executed;
+  forwarded[from < MEM2 ? from : MEM2]++;
+  return 1;
+}
+
+/*
+ * Lets the group stage s holds for its functional units count down
+ * one cycle, then passes it on to stage s + 1 once that is free.
+ * Returns 1 if it was passed on.
+ */
+static int
+release(APEX_CPU* cpu, int s)
+{
+  CPU_Stage* stage = cpu->stage[s];
+  if (stage->busy > 1) {
+    stage->busy--;
+    return 0;
+  }
+  if (occupied(cpu, s + 1)) {
+    return 0;
+  }
+  stage->busy = 0;
+  pass_group(cpu, s, s + 1);
+  return 1;
+}
+
+/* Stage contents are wanted, either printed or in a binary trace */
+static inline int
+tracing(const APEX_CPU* cpu)
+{
+  return cpu->enable_debug_messages || cpu->trace;
+}
+
+/* Records the stage in the binary trace if one is open, else prints it,
+ * one line for every instruction of an active group */
+static void
+report_stage(APEX_CPU* cpu, int s, CPU_Stage* group, int is_active)
+{
+  int count = is_active ? lanes(group) : 1;
+  for (int lane = 0; lane < count; ++lane) {
+    if (cpu->trace) {
+      APEX_trace_stage(cpu->trace, s, &group[lane], is_active);
+    } else {
+      print_stage_content(stage_names[s], &group[lane], is_active);
+    }
+  }
+}
+
+/*
+ *  Fetch Stage of APEX Pipeline
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+/* Copies the instruction at pc into the latch, past the end of the program the sentinel */
+static inline void
+fetch_instruction(const APEX_CPU* cpu, CPU_Stage* stage, int pc)
+{
+  /* Index into code memory using this pc and copy all instruction fields into
+   * fetch latch
+   */
+  const APEX_Instruction* current_ins = &end_of_program;
+  if (get_code_index(pc) < cpu->code_memory_size) {
+    current_ins = &cpu->code_memory[get_code_index(pc)];
+  }
+  stage->pc = pc;
+  stage->op = current_ins->op;
+  stage->op_flags = current_ins->op_flags;
+  stage->rd = current_ins->rd;
+  stage->rs1 = current_ins->rs1;
+  stage->rs2 = current_ins->rs2;
+  stage->rs3 = current_ins->rs3;
+  stage->imm = current_ins->imm;
+}
+
+int
+fetch(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = cpu->stage[F];
+  stage->is_empty = 0;
+  if (!stage->busy && !stage->stalled) {  
+    /* Look the PC up in the I-cache, once: a PC already in the latch is
+     * being retried after a stall */
+    if (stage->pc != cpu->pc && cpu->icache.sets && get_code_index(cpu->pc) < cpu->code_memory_size) {
+      stage->busy = APEX_cache_access(&cpu->icache, cpu->pc / 4, 0);
+    }
+
+    /* Store current PC in fetch latch */
+    fetch_instruction(cpu, stage, cpu->pc);
+    stage->count = 1;
+
+    /* Copy data from fetch latch to decode latch*/
+    if (stage->busy) {
+      /* I-cache miss, the instruction arrives once busy runs out */
+    } else if(!cpu->stage[DRF]->stalled) {
+      /* Fetch up to width consecutive instructions. The group ends after
+       * a branch predicted taken, before the end of the program and, with
+       * an I-cache, at the end of the line that was looked up */
+      int count = 0;
+      for (;;) {
+        CPU_Stage* ins = &stage[count++];
+        /* Follow the branch predictor, EX2 checks where fetch went */
+        ins->predicted_pc = ins->pc + 4;
+        if ((ins->op_flags & OPF_BRANCH) && cpu->bpred.kind != BPRED_NONE) {
+          ins->predicted_pc = APEX_bpred_predict(&cpu->bpred, ins->pc, ins->op, ins->imm, &ins->bpred_counter);
+        }
+        ins->seq = ++cpu->last_seq;
+        int next_pc = ins->predicted_pc;
+        if (count == cpu->width || next_pc != ins->pc + 4 || get_code_index(next_pc) >= cpu->code_memory_size ||
+            (cpu->icache.sets && (next_pc / 4) % cpu->icache.line_words == 0)) {
+          break;
+        }
+        fetch_instruction(cpu, &stage[count], next_pc);
+      }
+      stage->count = count;
+      pass_group(cpu, F, DRF);
+      cpu->stage_seq[F] = stage[count - 1].seq;
+      cpu->pc = stage[count - 1].predicted_pc;
+    } else {
+      stage->stalled = 1;
+    }
+  }
+  if (stage->busy) {
+    stage->busy--;
+    cpu->stats.stall_fetch++;
+  }
+  stage->is_empty = 1;
+  if (tracing(cpu)) {
+      report_stage(cpu, F, stage, get_code_index(stage->pc) < cpu->code_memory_size);
+    }
+  return 0;
+}
+
+/*
+ * Reads the source registers of the instruction in stage, forwarding as
+ * the hazard policy allows. Returns 0 if one of them is not available yet.
+ */
+static int
+read_operands(APEX_CPU* cpu, CPU_Stage* stage, int* forwarded)
+{
+  switch (stage->op) {
+  case OP_STR:
+  case OP_ADD:
+  case OP_SUB:
+  case OP_MUL:
+  case OP_AND:
+  case OP_OR:
+  case OP_EXOR:
+  case OP_LDR:
+  case OP_STORE:
+  case OP_ADDL:
+  case OP_SUBL:
+  case OP_LOAD:
+  case OP_JUMP:
+    return read_source(cpu, stage->rs1, &stage->rs1_value, forwarded) &&
+           (!(stage->op_flags & OPF_RS2) || read_source(cpu, stage->rs2, &stage->rs2_value, forwarded)) &&
+           (!(stage->op_flags & OPF_RS3) || read_source(cpu, stage->rs3, &stage->rs3_value, forwarded));
+  case OP_BZ:
+  case OP_BNZ:
+    return read_source(cpu, CC, &stage->buffer, forwarded);
+
+  /* No Register file read needed for MOVC */
+  case OP_MOVC:
+  default:
+    return 1;
+  }
+}
+
+/*
+ * Reads the operands of the instructions of the decode group that go to
+ * EX1 together this cycle and returns how many they are. They are taken
+ * in program order as long as each can read its operands and none reads
+ * a register, CC included, written by an earlier one of the group. There
+ * is a single multiplier, and a branch or HALT is the last of its group.
+ */
+static int
+issue_group(APEX_CPU* cpu, CPU_Stage* group, int forwarded[NUM_STAGES])
+{
+  int written = 0;
+  int issued = 0;
+  int has_mul = 0;
+  while (issued < lanes(group)) {
+    CPU_Stage* stage = &group[issued];
+    int sources[3];
+    decode_sources(stage, sources);
+    int depends = 0;
+    for (int i = 0; i < 3; ++i) {
+      depends |= sources[i] >= 0 && (written & (1 << sources[i]));
+    }
+    int lane_forwarded[NUM_STAGES] = { 0 };
+    if (depends || (stage->op == OP_MUL && has_mul) || !read_operands(cpu, stage, lane_forwarded)) {
+      break;
+    }
+    for (int i = EX1; i <= MEM2; ++i) {
+      forwarded[i] += lane_forwarded[i];
+    }
+    issued++;
+    if (stage->op == OP_HALT) {
+      cpu->halt_and_flush = 1;
+      CPU_Stage* ex1_stage = cpu->stage[EX2];//Since the ex2 stage contents will be moved to mem1 as part ex1 is executed before drf
+      if(ends_in_branch(ex1_stage)) {
+        cpu->halt_and_flush = 0;
+      }
+      CPU_Stage* ex2_stage = cpu->stage[MEM1];//Since the ex2 stage contents will be moved to mem1 as part ex2 is executed before ex1 and drf
+      if(cpu->halt_and_flush && ends_in_branch(ex2_stage)) {
+        cpu->halt_and_flush = 0;
+      }
+    }
+    if (stage->op == OP_HALT || (stage->op_flags & OPF_BRANCH)) {
+      break;
+    }
+    written |= (stage->op_flags & OPF_RD) ? 1 << stage->rd : 0;
+    written |= (stage->op_flags & OPF_SETS_CC) ? 1 << CC : 0;
+    has_mul |= stage->op == OP_MUL;
+  }
+  return issued;
+}
+
+/*
+ *  Decode Stage of APEX Pipeline
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+decode(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = cpu->stage[DRF];
+  int issued = 0;
+  stage->stalled = 0;
+  stage->is_empty = 0;
+  if(stage->pc >= 4000) {
+    /* Fetch may not have replaced the instruction passed on last cycle */
+    if (!stage->busy && !stage->stalled && is_pending(cpu, stage, DRF)) {
+      int forwarded[NUM_STAGES] = { 0 };
+      /* EX1 may still hold an earlier group for its functional units */
+      if (!occupied(cpu, EX1)) {
+        issued = issue_group(cpu, stage, forwarded);
+      }
+
+      /* Copy data from decode latch to execute latch*/
+      //Stall here if any of the instructions in the subsequent stages is an arithmetic instruction, if no instruction is present there or no instruction is an arithmetic operation dont stall
+      if(!issued) {
+        stage->stalled = 1;
+        (*decode_stall_counter(cpu, stage))++;
+        if (!tracing(cpu)) {
+          cpu->decode_wakeup = decode_ready_at(cpu, stage);
+        }
+      } else {
+        for (int i = EX1; i <= MEM2; ++i) {
+          cpu->stats.forwarded[i] += forwarded[i];
+        }
+        cpu->stats.issued[issued]++;
+        memcpy(cpu->stage[EX1], stage, issued * sizeof(CPU_Stage));
+        cpu->stage[EX1]->count = issued;
+        cpu->stage_seq[DRF] = stage[issued - 1].seq;
+        /* The rest of the group is issued next cycle, fetch waits for it */
+        stage->stalled = issued < lanes(stage);
+        cpu->stage[F]->stalled = stage->stalled;
+      }
+    }
+    if (tracing(cpu)) {
+        report_stage(cpu, DRF, stage, (is_pending(cpu, stage, EX1) && get_code_index(stage->pc) < cpu->code_memory_size));
+      }
+    if (issued && issued < lanes(stage)) {
+      int count = lanes(stage) - issued;
+      memmove(stage, stage + issued, count * sizeof(CPU_Stage));
+      stage->count = count;
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, DRF, stage, 0);
+  }
+  stage->is_empty = 1;
+  return 0;
+}
+
+/*
+ * Computes the result, or the memory address, of the instruction in
+ * stage from its operand values, as the ALU or multiplier of EX1 does
+ */
+void
+APEX_alu_compute(CPU_Stage* stage)
+{
+  switch (stage->op) {
+  /* Store */
+  case OP_STORE:
+    stage->mem_address = stage->rs2_value + stage->imm;
+    break;
+  case OP_STR:
+    stage->mem_address = stage->rs2_value + stage->rs3_value;
+    break;
+  case OP_LOAD:
+    stage->mem_address = stage->rs1_value + stage->imm;
+    break;
+  case OP_LDR:
+    stage->mem_address = stage->rs1_value + stage->rs2_value;
+    break;
+  case OP_ADD:
+    stage->buffer = stage->rs1_value + stage->rs2_value;
+    break;
+  case OP_SUB:
+    stage->buffer = stage->rs1_value - stage->rs2_value;
+    break;
+  case OP_ADDL:
+    stage->buffer = stage->rs1_value + stage->imm;
+    break;
+  case OP_SUBL:
+    stage->buffer = stage->rs1_value - stage->imm;
+    break;
+  case OP_MUL:
+    stage->buffer = stage->rs1_value * stage->rs2_value;
+    break;
+  case OP_AND:
+    stage->buffer = stage->rs1_value & stage->rs2_value;
+    break;
+  case OP_OR:
+    stage->buffer = stage->rs1_value | stage->rs2_value;
+    break;
+  case OP_EXOR:
+    stage->buffer = stage->rs1_value ^ stage->rs2_value;
+    break;
+  case OP_JUMP:
+    stage->buffer = stage->rs1_value + stage->imm;
+    //TBD
+    break;
+  /* MOVC */
+  case OP_MOVC:
+    stage->buffer = stage->imm + 0;
+    break;
+  case OP_HALT:
+  default:
+    //No need to do anything here
+    break;
+  }
+}
+
+/*
+ *  Execute Stage of APEX Pipeline
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+execute1(APEX_CPU* cpu)
+{
+  //Set registered valid for the destination to 0 when entering
+  CPU_Stage* group = cpu->stage[EX1];
+  //stage->stalled = 0;
+  group->is_empty = 0;
+  if(group->pc >= 4000) {
+    if (!group->busy && !group->stalled && is_pending(cpu, group, EX1)) {
+      /* Every instruction of the group has an ALU or the multiplier of
+       * its own; the group moves on once the slowest unit takes the next */
+      int busy = 0;
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if(stage->rd < 16 && stage->rd >= 0) {
+          cpu->regs_valid[stage->rd] = 0;
+        }
+        APEX_alu_compute(stage);
+
+        /* The unit has the result after latency cycles and takes the next
+         * instruction after interval cycles, until then EX1 holds this one */
+        const APEX_Unit* unit = &cpu->units[stage->op == OP_MUL ? UNIT_MUL : UNIT_ALU];
+        stage->done = cpu->clock + unit->latency - 1;
+        if (unit->interval > busy) {
+          busy = unit->interval;
+        }
+      }
+      group->busy = busy;
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if (stage->op_flags & OPF_RD) {
+          set_producer(cpu, stage->rd, stage, cpu->clock + busy - 1);
+        }
+        if (stage->op_flags & OPF_SETS_CC) {
+          set_producer(cpu, CC, stage, cpu->clock + busy - 1);
+        }
+      }
+      cpu->stage_seq[EX1] = group[lanes(group) - 1].seq;
+    }
+    /* Copy data from Execute latch to Execute2 latch*/
+    if (group->busy) {
+      release(cpu, EX1);
+    }
+    if (tracing(cpu)) {
+        report_stage(cpu, EX1, group, (is_pending(cpu, group, EX2) && get_code_index(group->pc) < cpu->code_memory_size));
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, EX1, group, 0);
+  }
+  group->is_empty = 1;
+  return 0;
+}
+
+int execute2(APEX_CPU* cpu) {
+  CPU_Stage* group = cpu->stage[EX2];
+  group->is_empty = 0;
+  if(group->pc >= 4000) {
+    if(!group->busy && !group->stalled && is_pending(cpu, group, EX2) && !occupied(cpu, MEM1)) {
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if(stage->rd < 16 && stage->rd >= 0) {
+          cpu->regs_valid[stage->rd] = 0;
+        }
+        switch (stage->op) {
+        case OP_BZ:
+        case OP_BNZ:
+        case OP_JUMP: {
+          /* buffer holds the CC flag read at decode, or the JUMP target computed in EX1 */
+          int taken = stage->op == OP_JUMP || (stage->op == OP_BZ && stage->buffer == 1) || (stage->op == OP_BNZ && stage->buffer == 0);
+          int target = stage->op == OP_JUMP ? stage->buffer : stage->pc + stage->imm;
+          if (taken) {
+            int ins_index = get_code_index(target);
+            assert(target % 4 == 0 && ins_index < cpu->code_memory_size && ins_index >= 0);
+          }
+          int next_pc = taken ? target : stage->pc + 4;
+          APEX_bpred_update(&cpu->bpred, stage->pc, stage->op, stage->bpred_counter, taken, target, next_pc != stage->predicted_pc);
+          if (next_pc != stage->predicted_pc) {
+            //Fetch went the wrong way: flush out the contents of F, DRF and EX1 stages and refetch from next_pc
+            cpu->flush_and_reload_pc = next_pc;
+          }
+          break;
+        }
+        case OP_HALT:
+          if(cpu->halt_and_flush == 0) {
+            cpu->halt_and_flush = 2;
+          }
+          break;
+        case OP_STR:
+        case OP_STORE:
+        case OP_LDR:
+        case OP_LOAD:
+          break;
+        default:
+          break;
+        }
+      }
+      pass_group(cpu, EX2, MEM1);
+      cpu->stage_seq[EX2] = group[lanes(group) - 1].seq;
+    }
+    if (tracing(cpu)) {
+      report_stage(cpu, EX2, group, (is_pending(cpu, group, MEM1) && get_code_index(group->pc) < cpu->code_memory_size));
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, EX2, group, 0);
+  }
+  group->is_empty = 1;
+  return 0;
+}
+
+/*
+ *  Memory Stage of APEX Pipeline
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+memory1(APEX_CPU* cpu)
+{
+  CPU_Stage* group = cpu->stage[MEM1];
+  group->is_empty = 0;
+  if(group->pc >= 4000) {
+    if (!group->busy && !group->stalled && is_pending(cpu, group, MEM1)) {
+      /* There is one memory port: the accesses of a group take it in
+       * program order, each once the one before has left it */
+      int port = 0;
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if(stage->rd < 16 && stage->rd >= 0) {
+          cpu->regs_valid[stage->rd] = 0;
+        }
+        if (stage->op_flags & (OPF_LOAD | OPF_STORE)) {
+          /* A D-cache miss blocks the memory port until the line is filled */
+          int miss_cycles = cpu->dcache.sets ? APEX_cache_access(&cpu->dcache, stage->mem_address, (stage->op_flags & OPF_STORE) != 0) : 0;
+          if (stage->op_flags & OPF_LOAD) {
+            stage->done = cpu->clock + port + cpu->units[UNIT_MEM].latency + miss_cycles;
+          }
+          port += cpu->units[UNIT_MEM].interval + miss_cycles;
+        }
+      }
+      group->busy = port > 1 ? port : 1;
+      cpu->stage_seq[MEM1] = group[lanes(group) - 1].seq;
+    }
+    /* Copy data from memory1 latch to memory2 latch*/
+    if (group->busy) {
+      release(cpu, MEM1);
+    }
+    if (tracing(cpu)) {
+      report_stage(cpu, MEM1, group, (is_pending(cpu, group, MEM2) && get_code_index(group->pc) < cpu->code_memory_size));
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, MEM1, group, 0);
+  }
+  group->is_empty = 1;
+  if (!group->busy) {
+    group->pc = 0;
+  }
+  return 0;
+}
+
+int memory2(APEX_CPU* cpu) {
+  CPU_Stage* group = cpu->stage[MEM2];
+  group->is_empty = 0;
+  if(group->pc >= 4000) {
+    if(!group->busy && !group->stalled && is_pending(cpu, group, MEM2) && !occupied(cpu, WB)) {
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if(stage->rd < 16 && stage->rd >= 0) {
+          cpu->regs_valid[stage->rd] = 0;
+        }
+        switch (stage->op) {
+        case OP_STORE:
+        case OP_STR:
+          APEX_memory_write(&cpu->data_memory, stage->mem_address, stage->rs1_value);
+          APEX_watch_memory(cpu, stage->mem_address, stage->pc);
+          break;
+        case OP_LOAD:
+        case OP_LDR:
+          stage->buffer = APEX_memory_read(&cpu->data_memory, stage->mem_address);
+          load_arrived(cpu, stage);
+          break;
+        default:
+          break;
+        }
+      }
+      pass_group(cpu, MEM2, WB);
+      cpu->stage_seq[MEM2] = group[lanes(group) - 1].seq;
+    }
+    if (tracing(cpu)) {
+      report_stage(cpu, MEM2, group, (is_pending(cpu, group, WB) && get_code_index(group->pc) < cpu->code_memory_size));
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, MEM2, group, 0);
+  }
+  group->is_empty = 1;
+  if (!is_pending(cpu, group, MEM2)) {
+    group->pc = 0;
+  }
+  return 0;
+}
+/*
+ *  Writeback Stage of APEX Pipeline
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+writeback(APEX_CPU* cpu)
+{
+  CPU_Stage* group = cpu->stage[WB];
+  int stage_executed = 0;
+  group->is_empty = 0;
+  if(group->pc >= 4000) {
+    if (!group->busy && !group->stalled && is_pending(cpu, group, WB) && !result_pending(cpu, group)) {
+      for (int lane = 0; lane < lanes(group); ++lane) {
+        CPU_Stage* stage = &group[lane];
+        if(stage->rd < 16 && stage->rd >= 0) {
+          cpu->regs_valid[stage->rd] = 1;
+          if (cpu->scoreboard[stage->rd].seq == stage->seq) {
+            cpu->scoreboard[stage->rd].seq = 0;
+          }
+        }
+        if (cpu->scoreboard[CC].seq == stage->seq) {
+          cpu->scoreboard[CC].seq = 0;
+        }
+        /* Update register file */
+        switch (stage->op) {
+        case OP_MOVC:
+        case OP_LOAD:
+        case OP_LDR:
+        case OP_AND:
+        case OP_OR:
+        case OP_EXOR:
+          cpu->regs[stage->rd] = stage->buffer;
+          APEX_watch_register(cpu, stage->rd, stage->pc);
+          break;
+        case OP_ADD:
+        case OP_ADDL:
+        case OP_SUB:
+        case OP_SUBL:
+        case OP_MUL:
+          cpu->regs[stage->rd] = stage->buffer;
+          cpu->regs[CC] = (stage->buffer == 0);
+          APEX_watch_register(cpu, stage->rd, stage->pc);
+          APEX_watch_register(cpu, CC, stage->pc);
+          break;
+        case OP_HALT:
+          /* HALT ends the run whether or not the pipeline is being traced */
+          if(tracing(cpu)) {
+            report_stage(cpu, WB, group, 1);
+          }
+          cpu->ins_completed++;
+          cpu->halted = 1;
+          return 1;
+        default:
+          break;
+        }
+        cpu->ins_completed++;
+      }
+      cpu->stage_seq[WB] = group[lanes(group) - 1].seq;
+      stage_executed = 1;
+    }
+    if(get_code_index(group->pc) == cpu->code_memory_size) {
+      return 2;
+    }
+    if (tracing(cpu)) {
+      report_stage(cpu, WB, group, ((stage_executed || is_pending(cpu, group, WB)) && get_code_index(group->pc) < cpu->code_memory_size));
+    }
+  } else if (tracing(cpu)) {
+    report_stage(cpu, WB, group, 0);
+  }
+  group->is_empty = 1;
+  if (!is_pending(cpu, group, WB)) {
+    group->pc = 0;
+  }
+  return 0;
+}
+
+int print_register_state(APEX_CPU* cpu) {
+  printf("=============== STATE OF ARCHITECTURAL REGISTER FILE ==========\n");
+  int index;
+  int no_registers = (int) (sizeof(cpu->regs)/sizeof(cpu->regs[0]));
+  for(index = 0; index < no_registers - 1; ++index) {//Assummin CC register is also part of the register file
+    printf("| \t REG[%d] \t | \t Value=%d \t | \t STATUS=%s \t |\n", index, cpu->regs[index], (cpu->regs_valid[index] ? "VALID" : "INVALID"));
+  }
+  return 0;
+}
+
+/*
+ * Prints count words of data memory from address on or, if count is 0,
+ * the words that are not 0 in every page a store has touched
+ */
+int print_data_memory(APEX_CPU* cpu, uint32_t address, uint32_t count) {
+  printf("============== STATE OF DATA MEMORY =============\n");
+  if (count) {
+    for (uint32_t n = 0; n < count; ++n) {
+      printf("| \t MEM[%u] \t | \t Data Value=%d \t |\n", address + n, APEX_memory_read(&cpu->data_memory, address + n));
+    }
+    return 0;
+  }
+  uint32_t num_pages;
+  APEX_MemoryPage** pages = APEX_memory_sorted_pages(&cpu->data_memory, &num_pages);
+  for (uint32_t i = 0; pages && i < num_pages; ++i) {
+    for (int offset = 0; offset < APEX_PAGE_WORDS; ++offset) {
+      if (pages[i]->words[offset]) {
+        printf("| \t MEM[%u] \t | \t Data Value=%d \t |\n", (pages[i]->number << APEX_PAGE_BITS) + offset, pages[i]->words[offset]);
+      }
+    }
+  }
+  free(pages);
+  return 0;
+}
+/*
+ *  APEX CPU simulation loop
+ *
+ *  Runs until the program drains or the clock passes no_of_cycles. Prints
+ *  nothing beyond the per-cycle trace when enable_debug_messages is set,
+ *  and nothing at all when the trace goes to cpu->trace instead. Once
+ *  configured, the out-of-order engine runs in place of the pipeline.
+ *
+ *  Note : You are free to edit this function according to your
+ * 				 implementation
+ */
+int
+APEX_cpu_simulate(APEX_CPU* cpu, int no_of_cycles)
+{
+  if (cpu->ooo.rob_size) {
+    return APEX_ooo_simulate(cpu, no_of_cycles);
+  }
+  while (!cpu->halted && cpu->clock <= no_of_cycles) {
+    /* Only a stalled decode and units counting down are left until the
+     * next event: jump the clock there */
+    int quiet = !tracing(cpu) && !cpu->halt_and_flush ? quiet_until(cpu) : 0;
+    if (cpu->clock + 1 < quiet) {
+      int wakeup = quiet <= no_of_cycles ? quiet : no_of_cycles + 1;
+      int skipped = wakeup - cpu->clock;
+      for (int s = EX1; s <= WB; ++s) {
+        if (cpu->stage[s]->busy > 1) {
+          cpu->stage[s]->busy -= skipped;
+        }
+      }
+      if (cpu->stage[F]->busy) {
+        cpu->stage[F]->busy -= skipped;
+        cpu->stats.stall_fetch += skipped;
+      }
+      cpu->stats.cycles += skipped;
+      if (is_pending(cpu, cpu->stage[DRF], DRF)) {
+        *decode_stall_counter(cpu, cpu->stage[DRF]) += skipped;
+      }
+      cpu->clock = wakeup;
+      continue;
+    }
+
+    /* All the instructions committed, so exit */
+    /*if (get_code_index(cpu->pc) > cpu->code_memory_size) {
+      printf("(apex) >> Simulation Complete\n");
+      break;
+    }*/
+
+    if (cpu->trace) {
+      APEX_trace_cycle(cpu->trace, cpu->clock+1);
+    } else if (cpu->enable_debug_messages) {
+      printf("--------------------------------\n");
+      printf("Clock Cycle #: %d\n", cpu->clock+1);
+      printf("--------------------------------\n");
+    }
+
+    cpu->stats.cycles++;
+    int writeback_result = writeback(cpu);
+    if(writeback_result == 2) {
+      break;
+    }
+    memory2(cpu);
+    memory1(cpu);
+    execute2(cpu);
+    execute1(cpu);
+    if (cpu->clock < cpu->decode_wakeup && !tracing(cpu)) {
+      /* Decode would repeat its stall, and fetch stays held behind it,
+       * or waits for the I-cache */
+      (*decode_stall_counter(cpu, cpu->stage[DRF]))++;
+      if (cpu->stage[F]->busy) {
+        cpu->stage[F]->busy--;
+        cpu->stats.stall_fetch++;
+      }
+    } else {
+      decode(cpu);
+      fetch(cpu);
+    }
+    if(cpu->flush_and_reload_pc) {
+      /* Everything fetched behind the branch and not yet past EX2 is lost */
+      cpu->stats.branch_flushes++;
+      for (int i = DRF; i <= EX2; ++i) {
+        if (occupied(cpu, i) && get_code_index(cpu->stage[i]->pc) < cpu->code_memory_size) {
+          cpu->stats.squashed += lanes(cpu->stage[i]);
+        }
+      }
+      squash_executed(cpu);
+      cpu->pc = cpu->flush_and_reload_pc;
+      cpu->decode_wakeup = 0;
+      cpu->stage[EX2]->pc = cpu->stage[EX1]->pc = cpu->stage[DRF]->pc = cpu->stage[F]->pc = 0;
+      cpu->stage[EX1]->busy = cpu->stage[F]->busy = 0;
+      /* Fetch may have been held by a stalled decode, which is now gone */
+      cpu->stage[F]->stalled = 0;
+      for (int i = EX1; i <= EX2; ++i) {
+        for (int lane = 0; lane < lanes(cpu->stage[i]); ++lane) {
+          if(cpu->stage[i][lane].rd >= 0) {
+            cpu->regs_valid[cpu->stage[i][lane].rd] = 1;
+          }
+        }
+      }
+      cpu->flush_and_reload_pc = 0;
+    }
+    if(cpu->halt_and_flush) {
+      cpu->stats.halt_drain_cycles++;
+      cpu->pc = cpu->code_memory_size * 4 + 4000;
+      cpu->decode_wakeup = 0;
+      cpu->stage[DRF]->pc = cpu->stage[F]->pc = 0;
+      cpu->stage[F]->busy = 0;
+      if(cpu->halt_and_flush > 1) {
+        squash_executed(cpu);
+        cpu->stage[EX2]->pc = cpu->stage[EX1]->pc = 0;
+        cpu->stage[EX1]->busy = 0;
+        for (int i = EX1; i <= EX2; ++i) {
+          for (int lane = 0; lane < lanes(cpu->stage[i]); ++lane) {
+            if(cpu->stage[i][lane].rd >= 0) {
+              cpu->regs_valid[cpu->stage[i][lane].rd] = 1;
+            }
+          }
+        }
+      }
+    }
+    if(writeback_result) {
+      break;
+    }
+    cpu->clock++;
+  }
+  return 0;
+}
+
+/*
+ *  Simulates the program and dumps the final register state, the caller
+ *  picks what of the data memory to print
+ */
+int
+APEX_cpu_run(APEX_CPU* cpu, int no_of_cycles, int flag)
+{
+  cpu->enable_debug_messages = flag;
+  APEX_cpu_simulate(cpu, no_of_cycles);
+  printf("(apex) >> Simulation Complete\n");
+  print_register_state(cpu);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,767 @@
+#include<assert.h>
+#include<stddef.h>
+#include<stdint.h>
+#include<stdio.h>
+#ifndef _APEX_CPU_H_
+#define _APEX_CPU_H_
+#define CC 16
+/**
+ *  cpu.h
+ *  Contains various CPU and Pipeline Data structures
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+
+enum
+{
+  F,
+  DRF,
+  EX1,
+  EX2,
+  MEM1,
+  MEM2,
+  WB,
+  NUM_STAGES
+};
+
+/* Most instructions fetch, decode and the execute stages handle in one
+ * cycle. Every latch holds a group of up to this many, in program order */
+#define APEX_MAX_WIDTH 4
+
+/* How decode resolves data hazards. A build compiled with
+ * -DAPEX_HAZARD_POLICY=<policy> is specialized for that policy only,
+ * otherwise the policy is taken from APEX_CPU at run time */
+enum
+{
+  HAZARD_INTERLOCK,          // Stall until the producer has written back
+  HAZARD_FORWARD,            // Forward every result in the cycle it is computed
+  HAZARD_FORWARD_LOAD_STALL, // Forward from EX2, MEM1 and MEM2, stall behind EX1 and LOADs
+  NUM_HAZARD_POLICIES
+};
+
+extern const char* const hazard_policy_names[NUM_HAZARD_POLICIES];
+
+/* Functional units with a configurable timing */
+enum
+{
+  UNIT_ALU, // EX1, every instruction but MUL, address computation included
+  UNIT_MUL, // EX1, MUL
+  UNIT_MEM, // MEM1, data memory access of LOAD, LDR, STORE and STR
+  NUM_UNITS
+};
+
+extern const char* const unit_names[NUM_UNITS];
+
+/* Timing of a functional unit: the result is computed latency cycles
+ * after an instruction enters the unit, and the unit takes the next one
+ * interval cycles after it. An interval of 1 is a fully pipelined unit,
+ * an interval equal to the latency a blocking one */
+typedef struct APEX_Unit
+{
+  int latency;
+  int interval;
+} APEX_Unit;
+
+/* Most lines a cache model can have, the tags live inside APEX_CPU */
+#define APEX_CACHE_MAX_LINES 1024
+/* Most ways of a set, PLRU keeps a tree of ways - 1 bits per set */
+#define APEX_CACHE_MAX_WAYS 16
+
+enum
+{
+  REPLACE_LRU,
+  REPLACE_PLRU,
+  NUM_REPLACEMENTS
+};
+
+extern const char* const replacement_names[NUM_REPLACEMENTS];
+
+typedef struct APEX_CacheLine
+{
+  uint64_t last_use; // Access count of the latest hit or fill, for LRU
+  uint32_t tag;      // Line address divided by the number of sets
+  uint8_t valid;
+  uint8_t dirty;     // Written since the fill, write-back caches only
+} APEX_CacheLine;
+
+/* Timing model of a set-associative cache. It keeps tags only: the data
+ * stays in data_memory, a hit or miss only decides how long an access
+ * takes. Sizes are in words, the unit APEX addresses memory in. */
+typedef struct APEX_Cache
+{
+  int sets;          // 0 when there is no cache
+  int ways;
+  int line_words;
+  int miss_penalty;  // Extra cycles of a fill, and of a dirty line written back
+  int replacement;   // REPLACE_*
+  int write_back;    // 1: write-back, write-allocate; 0: write-through, no write-allocate
+  uint64_t accesses;
+  long hits;
+  long misses;
+  long evictions;    // Valid lines replaced by a fill
+  long writebacks;   // Dirty lines among them
+  /* Multi-core systems only, see coherence.c */
+  struct APEX_Coherence* coherence; // MESI directory shared with the L1s of the other cores, NULL for one core
+  int core;                 // Bit of this cache in the sharer masks of the directory
+  long coherence_misses;    // Misses on a line the write of another core invalidated
+  long upgrades;            // Writes to a shared line, invalidating the other copies
+  long interventions;       // Misses on a line modified in another L1, written back to serve them
+  uint16_t plru[APEX_CACHE_MAX_LINES]; // One tree per set
+  APEX_CacheLine lines[APEX_CACHE_MAX_LINES]; // Set after set
+} APEX_Cache;
+
+/* Data memory spans the 32-bit word address space in pages of this many
+ * words. A page is allocated by the first store to it; a load from a page
+ * never stored to reads 0 */
+#define APEX_PAGE_BITS 10
+#define APEX_PAGE_WORDS (1 << APEX_PAGE_BITS)
+
+typedef struct APEX_MemoryPage
+{
+  uint32_t number; // Address of the first word >> APEX_PAGE_BITS
+  int words[APEX_PAGE_WORDS];
+} APEX_MemoryPage;
+
+/* Number of pages of the 32-bit word address space */
+#define APEX_NUM_PAGES (1u << (32 - APEX_PAGE_BITS))
+
+/* Data memory shared by the cores of a multi-core system. Pages are
+ * installed with compare-and-swap, so cores allocate them without a lock */
+typedef struct APEX_SharedMemory
+{
+  APEX_MemoryPage** pages; // APEX_NUM_PAGES entries, NULL for a page never stored to
+} APEX_SharedMemory;
+
+typedef struct APEX_Memory
+{
+  APEX_MemoryPage** table; // Hashed on the page number, linear probing, NULL slots free
+  uint32_t capacity;       // Slots of table, a power of two, 0 until the first store
+  uint32_t count;          // Pages allocated, or found in shared
+  APEX_MemoryPage* last;   // Page of the latest access, looked at before the table
+  APEX_SharedMemory* shared; // Owner of the pages of a core of a multi-core system, NULL otherwise
+} APEX_Memory;
+
+/* Branch direction predictors of fetch */
+enum
+{
+  BPRED_NONE,    // Always fall through, every taken branch flushes
+  BPRED_STATIC,  // JUMP and backward BZ/BNZ taken, forward ones not
+  BPRED_BIMODAL, // 2-bit counter per PC
+  BPRED_GSHARE,  // 2-bit counter per PC xor global history
+  NUM_BPREDS
+};
+
+extern const char* const bpred_names[NUM_BPREDS];
+
+/* Largest pattern table and BTB, both live inside APEX_CPU */
+#define APEX_BPRED_MAX_TABLE_BITS 12
+#define APEX_BTB_MAX_ENTRIES 1024
+
+typedef struct APEX_BtbEntry
+{
+  int pc;     // Branch the entry belongs to, 0 when empty
+  int target; // Where it went the last time it was taken
+} APEX_BtbEntry;
+
+/* Branch predictor and branch target buffer. fetch only redirects to a
+ * predicted-taken branch's target when the BTB has it; EX2 trains both
+ * with the outcome, the counter fetch predicted with included. */
+typedef struct APEX_BranchPredictor
+{
+  int kind;          // BPRED_*
+  int table_bits;    // log2 of the number of 2-bit counters
+  int history_bits;  // Global history length of gshare
+  int btb_entries;   // Direct mapped
+  uint32_t history;  // Outcomes of the latest BZ and BNZ, newest in bit 0
+  long branches;     // BZ, BNZ and JUMP resolved by EX2
+  long taken;
+  long mispredicted; // Those fetch did not follow, each one flushes
+  long btb_misses;   // Predicted taken without a target to go to
+  uint8_t counters[1 << APEX_BPRED_MAX_TABLE_BITS];
+  APEX_BtbEntry btb[APEX_BTB_MAX_ENTRIES];
+} APEX_BranchPredictor;
+
+/* Operation codes, decoded once by the file parser */
+typedef enum APEX_Opcode
+{
+  OP_NONE,
+  OP_MOVC,
+  OP_ADD,
+  OP_ADDL,
+  OP_SUB,
+  OP_SUBL,
+  OP_MUL,
+  OP_AND,
+  OP_OR,
+  OP_EXOR,
+  OP_LOAD,
+  OP_LDR,
+  OP_STORE,
+  OP_STR,
+  OP_BZ,
+  OP_BNZ,
+  OP_JUMP,
+  OP_HALT,
+  OP_NOP,
+  NUM_OPCODES
+} APEX_Opcode;
+
+/* Operand class bits of an opcode */
+enum
+{
+  OPF_RD = 1 << 0,      // Writes rd
+  OPF_RS1 = 1 << 1,     // Reads rs1
+  OPF_RS2 = 1 << 2,     // Reads rs2
+  OPF_RS3 = 1 << 3,     // Reads rs3
+  OPF_IMM = 1 << 4,     // Has a literal
+  OPF_SETS_CC = 1 << 5, // Updates the Z flag at writeback
+  OPF_LOAD = 1 << 6,    // Reads data memory
+  OPF_STORE = 1 << 7,   // Writes data memory
+  OPF_BRANCH = 1 << 8   // Redirects the PC in EX2
+};
+
+/* Static description of an opcode: mnemonic and operand classes */
+typedef struct APEX_OpcodeInfo
+{
+  const char* name;
+  int flags;
+} APEX_OpcodeInfo;
+
+extern const APEX_OpcodeInfo opcode_info[NUM_OPCODES];
+
+/* Microarchitectural event counters, exported by APEX_stats_save */
+typedef struct APEX_Stats
+{
+  long cycles;              // Cycles simulated by the pipeline
+  long stall_raw;           // Decode stall cycles waiting on a register
+  long stall_cc;            // Decode stall cycles of BZ/BNZ waiting on the CC flag
+  long stall_load_use;      // Decode stall cycles waiting on a LOAD/LDR result
+  long stall_structural;    // Decode stall cycles waiting for EX1 to take an instruction
+  long stall_fetch;         // Cycles fetch waits for the I-cache to fill a line
+  long forwarded[NUM_STAGES]; // Operands, CC included, forwarded from EX1, EX2, MEM1, MEM2
+  long branch_flushes;      // Taken BZ/BNZ and JUMPs
+  long squashed;            // Wrong-path instructions flushed by them
+  long halt_drain_cycles;   // Cycles from HALT decode until it is written back
+  long issued[APEX_MAX_WIDTH + 1]; // Cycles n instructions were issued, for n > 0
+} APEX_Stats;
+
+/* Location whose writes the pipeline records, for the last-write queries
+ * of the debugger, see debug.c */
+enum
+{
+  WATCH_NONE,
+  WATCH_REGISTER,
+  WATCH_MEMORY,
+};
+
+typedef struct APEX_Watch
+{
+  int kind;          // WATCH_*
+  int reg;           // Register, CC included, of WATCH_REGISTER
+  uint32_t address;  // Data memory word of WATCH_MEMORY
+  long writes;       // Writes recorded so far
+  int cycle;         // Cycle of the latest one, numbered as display prints it
+  int pc;            // Instruction that made it
+} APEX_Watch;
+
+/* Format of an APEX instruction, register addresses are -1 when unused.
+ * Code memory is never written once parsed, so one program image can be
+ * shared by many CPUs */
+typedef struct APEX_Instruction
+{
+  int imm;		    // Literal Value
+  uint16_t op_flags; // Operand class bits (OPF_*)
+  uint8_t op;     // Decoded APEX_Opcode
+  int8_t rd;		  // Destination Register Address
+  int8_t rs1;		  // Source-1 Register Address
+  int8_t rs2;		  // Source-2 Register Address
+  int8_t rs3;     // Source-3 Register Address
+} APEX_Instruction;
+
+/* Model of CPU stage latch, packed so that a latch advance is a copy of
+ * well under one cache line */
+typedef struct CPU_Stage
+{
+  int pc;		    // Program Counter
+  int imm;		    // Literal Value
+  int rs1_value;	// Source-1 Register Value
+  int rs2_value;	// Source-2 Register Value
+  int rs3_value;	// Source-3 Register Value for STR instructions -> can be removed if rd_value is added and rd is used instead of rs3 
+  int buffer;		// Latch to hold some value
+  int mem_address;	// Computed Memory Address
+  int done;       // Cycle in which the functional unit computes the result
+  int busy;		// Cycles the stage still holds the instruction for its functional unit
+  int predicted_pc; // PC fetch went on to after this instruction
+  uint32_t seq;     // Dynamic instance number given by fetch, 0 for none
+  uint16_t op_flags; // Operand class bits (OPF_*)
+  uint8_t op;     // Decoded APEX_Opcode
+  int8_t rs1;		  // Source-1 Register Address
+  int8_t rs2;		  // Source-2 Register Address
+  int8_t rs3;     // Source-3 Register Address for STR instructions
+  int8_t rd;		  // Destination Register Address
+  uint8_t stalled;	// Flag to indicate, stage is stalled
+  uint8_t is_empty;
+  uint8_t count;    // Instructions in the group, kept in its first latch
+  uint16_t bpred_counter; // Counter fetch predicted a branch with, the one its outcome trains
+} CPU_Stage;
+
+_Static_assert(sizeof(CPU_Stage) <= 64, "CPU_Stage must fit in one cache line");
+
+/* Scoreboard entry of a register: its youngest producer that has been
+ * through EX1 and not yet written back */
+typedef struct APEX_Producer
+{
+  uint32_t seq;   // Sequence number of the producer, 0 when the register file is current
+  int executed;   // Cycle the producer went through EX1
+  int ready;      // First cycle decode may take value, per hazard policy
+  int value;      // Result, filled in by MEM2 for a LOAD or LDR
+  int is_load;    // Producer is a LOAD or LDR
+} APEX_Producer;
+
+/* Limits of the out-of-order engine, the ROB size a power of two */
+#define APEX_OOO_MAX_ROB 256
+#define APEX_OOO_MAX_IQ 64
+#define APEX_OOO_MAX_PRF 544
+
+/* Progress of an instruction in the ROB */
+enum
+{
+  ROB_WAITING, // In the issue queue
+  ROB_ISSUED,  // In a functional unit until ready
+  ROB_DONE     // Result available, waits to commit
+};
+
+/* ROB entry of the out-of-order engine */
+typedef struct APEX_RobEntry
+{
+  CPU_Stage ins;     // Instruction as fetched, operands and result as in a latch
+  int ready;         // Cycle the result is available, once issued
+  int target;        // Where a BZ, BNZ or JUMP goes if taken
+  int16_t src[3];    // Physical registers read, -1 where unused
+  int16_t dest;      // Physical register of rd, -1 for none
+  int16_t dest_cc;   // Physical register of CC, -1 for none
+  int16_t prev_dest; // Mappings of rd and CC before this instruction,
+  int16_t prev_cc;   // freed when it commits, restored when it is squashed
+  uint8_t state;     // ROB_*
+  uint8_t taken;
+  uint8_t mispredicted; // Fetch did not go to the PC the branch resolved to
+} APEX_RobEntry;
+
+/*
+ * Out-of-order back end, see ooo.c. Fetch hands groups to a rename stage
+ * that maps the registers, CC included, onto a physical register file
+ * and enters each instruction into the ROB and the issue queue. An
+ * instruction issues once its operands are available and a functional
+ * unit is free, oldest first; the ROB commits in program order into the
+ * architectural registers and data memory.
+ */
+typedef struct APEX_OutOfOrder
+{
+  int rob_size;  // 0 when the in-order pipeline runs
+  int iq_size;
+  int prf_size;
+  int rename[17];                  // Physical register of every architectural one
+  int prf[APEX_OOO_MAX_PRF];
+  int prf_ready[APEX_OOO_MAX_PRF]; // Cycle the value is available, INT_MAX until its producer issues
+  int16_t free_list[APEX_OOO_MAX_PRF];
+  int free_count;
+  APEX_RobEntry rob[APEX_OOO_MAX_ROB];
+  int rob_head;
+  int rob_count;
+  int16_t iq[APEX_OOO_MAX_IQ];     // ROB index of every waiting instruction, oldest first
+  int iq_count;
+  int alu_free[APEX_MAX_WIDTH];    // First cycle each ALU, the multiplier and
+  int mul_free;                    // the memory port take the next instruction
+  int port_free;
+
+  long stall_rob;      // Cycles rename waits for a ROB entry,
+  long stall_iq;       // an issue queue entry
+  long stall_prf;      // or a free physical register
+  long load_forwards;  // Loads that took the value of an older store still in the ROB
+  long rob_occupancy[APEX_OOO_MAX_ROB + 1]; // Cycles with n entries in use
+  long iq_occupancy[APEX_OOO_MAX_IQ + 1];
+  long prf_occupancy[APEX_OOO_MAX_PRF + 1];
+} APEX_OutOfOrder;
+
+/* Model of APEX CPU. All simulator state lives here, so independent
+ * instances can run concurrently on different threads */
+typedef struct APEX_CPU
+{
+  /* Set this flag to 1 to enable debug messages */
+  int enable_debug_messages;
+
+  /* HAZARD_* policy of decode, fixed in a specialized build */
+  int hazard_policy;
+  /* Instructions fetched, decoded and executed per cycle, at most APEX_MAX_WIDTH */
+  int width;
+  /* Timing of the functional units, all single cycle by default */
+  APEX_Unit units[NUM_UNITS];
+
+  /* PC to refetch from after a taken branch or JUMP, 0 when there is none */
+  int flush_and_reload_pc;
+
+  /* 1 once HALT is decoded, 2 once it reaches EX2: front end is being drained */
+  int halt_and_flush;
+
+  /* Set once HALT has been written back */
+  int halted;
+  /* Decode is known to stall on its operands until this cycle, so the
+   * simulation loop neither runs decode nor fetch before it */
+  int decode_wakeup;
+
+  /* Clock cycles elasped */
+  int clock;
+
+  /* Current program counter */
+  int pc;
+
+  /* Integer register file */
+  int regs[17];//17th register is the condition code flag - right now used only for the Z flag
+  uint8_t regs_valid[17];//17th register is the condition code flag - right now used only for the Z flag
+
+  /* Latches of the 7 stages, each holding a group of width instructions;
+   * the first one carries the state of the whole group */
+  CPU_Stage stage[NUM_STAGES][APEX_MAX_WIDTH];
+
+  /* Pipeline progress: last sequence number handed out by fetch and,
+   * for each stage, the sequence number it processed most recently */
+  uint32_t last_seq;
+  uint32_t stage_seq[NUM_STAGES];
+
+  /* Code Memory where instructions are stored, read only */
+  const APEX_Instruction* code_memory;
+  int code_memory_size;
+  int owns_code_memory;
+
+  /* Checkpoint file the code memory is mapped from, if restored by APEX_cpu_load */
+  void* checkpoint_mapping;
+  size_t checkpoint_mapping_size;
+
+  /* Binary pipeline trace, replaces the printed stage contents when set */
+  struct APEX_Trace* trace;
+
+  /* Threaded code of the functional interpreter, built on first use */
+  struct APEX_Translation* translation;
+
+  /* Entries of a block before the functional interpreter compiles it to
+   * native code, 0 to never compile */
+  int jit_threshold;
+
+  /* Youngest in-flight producer of every register, the CC flag included;
+   * decode checks and forwards an operand with one lookup */
+  APEX_Producer scoreboard[17];
+
+  /* Some stats */
+  int ins_completed;
+  long ins_fast_forwarded; // Executed by the functional interpreter
+  APEX_Stats stats;
+
+  /* Writes the debugger is looking for, WATCH_NONE otherwise */
+  APEX_Watch watch;
+
+  /* Branch predictor and BTB of fetch */
+  APEX_BranchPredictor bpred;
+
+  /* L1 instruction cache, looked up by fetch, and L1 data cache in
+   * front of data_memory, accessed by MEM1 */
+  APEX_Cache icache;
+  APEX_Cache dcache;
+
+  /* Out-of-order back end, replaces EX1 to WB once configured */
+  APEX_OutOfOrder ooo;
+
+  /* Data Memory, the pages live outside APEX_CPU */
+  APEX_Memory data_memory;
+
+} APEX_CPU;
+
+/* Entries of a block before it is compiled, unless jit= says otherwise */
+#define APEX_JIT_THRESHOLD 64
+
+/* What native code of the JIT reads and updates, see jit.c. The
+ * generated code knows the offsets of these fields */
+typedef struct APEX_JitContext
+{
+  long remaining;          // Instructions the budget still allows
+  void* const* native_at;  // Native code of the block at each code memory index, NULL if none
+  APEX_Memory* memory;
+} APEX_JitContext;
+
+typedef struct APEX_JitBuffer APEX_JitBuffer;
+
+/* One stage line of a binary trace record */
+typedef struct APEX_TraceStage
+{
+  int32_t pc;
+  int32_t imm;
+  uint8_t op;
+  int8_t rd;
+  int8_t rs1;
+  int8_t rs2;
+  int8_t rs3;
+  uint8_t stage;      // Stage the line belongs to
+  uint8_t is_active;  // 0 when the stage is printed as EMPTY
+  uint8_t unused;
+} APEX_TraceStage;
+
+/* Stage lines of a cycle: one per instruction of every stage group */
+#define APEX_TRACE_MAX_LINES (NUM_STAGES * APEX_MAX_WIDTH)
+
+/* Binary trace record of one clock cycle, stage lines in printing order.
+ * Only the num_stages lines in use are stored in a trace file */
+typedef struct APEX_TraceRecord
+{
+  int32_t clock;
+  uint8_t num_stages;
+  uint8_t unused[3];
+  APEX_TraceStage stages[APEX_TRACE_MAX_LINES];
+} APEX_TraceRecord;
+
+typedef struct APEX_Trace APEX_Trace;
+
+extern const char* const stage_names[NUM_STAGES];
+
+APEX_Instruction*
+parse_code_memory(const char* text, size_t length, int* size);
+
+int
+APEX_operands_valid(int op, int op_flags, int rd, int rs1, int rs2, int rs3);
+
+int
+APEX_code_memory_valid(const APEX_Instruction* code_memory, int code_memory_size);
+
+const char*
+map_program_text(const char* filename, size_t* length);
+
+APEX_Instruction*
+create_code_memory(const char* filename, int* size);
+
+APEX_Instruction*
+APEX_load_program(const char* filename, const char* cache_dir, int* size);
+
+APEX_CPU*
+APEX_cpu_create(const APEX_Instruction* code_memory, int code_memory_size);
+
+APEX_CPU*
+APEX_cpu_init(const char* filename, const char* cache_dir);
+
+int
+APEX_cpu_set_hazard_policy(APEX_CPU* cpu, int policy);
+
+int
+APEX_hazard_policy_from_name(const char* name);
+
+int
+APEX_cpu_set_width(APEX_CPU* cpu, int width);
+
+int
+APEX_set_unit(APEX_Unit units[NUM_UNITS], const char* spec);
+
+int
+APEX_cache_configure(APEX_Cache* cache, const char* spec);
+
+int
+APEX_cache_valid(const APEX_Cache* cache);
+
+int
+APEX_cache_access(APEX_Cache* cache, uint32_t address, int is_write);
+
+struct APEX_Coherence*
+APEX_coherence_create(void);
+
+void
+APEX_coherence_free(struct APEX_Coherence* coherence);
+
+int
+APEX_coherence_hit(APEX_Cache* cache, uint32_t line, int is_write);
+
+int
+APEX_coherence_fill(APEX_Cache* cache, uint32_t line, int is_write);
+
+int
+APEX_coherence_evict(APEX_Cache* cache, uint32_t line);
+
+APEX_MemoryPage*
+APEX_memory_page(APEX_Memory* memory, uint32_t number, int allocate);
+
+/* Word at address, 0 if its page was never stored to */
+static inline int
+APEX_memory_read(APEX_Memory* memory, uint32_t address)
+{
+  APEX_MemoryPage* page = memory->last;
+  if (!page || page->number != address >> APEX_PAGE_BITS) {
+    page = APEX_memory_page(memory, address >> APEX_PAGE_BITS, 0);
+    if (!page) {
+      return 0;
+    }
+  }
+  return page->words[address & (APEX_PAGE_WORDS - 1)];
+}
+
+static inline void
+APEX_memory_write(APEX_Memory* memory, uint32_t address, int value)
+{
+  APEX_MemoryPage* page = memory->last;
+  if (!page || page->number != address >> APEX_PAGE_BITS) {
+    page = APEX_memory_page(memory, address >> APEX_PAGE_BITS, 1);
+  }
+  page->words[address & (APEX_PAGE_WORDS - 1)] = value;
+}
+
+/* Records the write of reg by the instruction at pc, if reg is watched */
+static inline void
+APEX_watch_register(APEX_CPU* cpu, int reg, int pc)
+{
+  if (cpu->watch.kind == WATCH_REGISTER && cpu->watch.reg == reg) {
+    cpu->watch.writes++;
+    cpu->watch.cycle = cpu->clock + 1;
+    cpu->watch.pc = pc;
+  }
+}
+
+/* Records the store to address by the instruction at pc, if address is watched */
+static inline void
+APEX_watch_memory(APEX_CPU* cpu, uint32_t address, int pc)
+{
+  if (cpu->watch.kind == WATCH_MEMORY && cpu->watch.address == address) {
+    cpu->watch.writes++;
+    cpu->watch.cycle = cpu->clock + 1;
+    cpu->watch.pc = pc;
+  }
+}
+
+APEX_MemoryPage**
+APEX_memory_sorted_pages(const APEX_Memory* memory, uint32_t* count);
+
+void
+APEX_memory_free(APEX_Memory* memory);
+
+APEX_SharedMemory*
+APEX_shared_memory_create(void);
+
+void
+APEX_shared_memory_free(APEX_SharedMemory* shared);
+
+int
+APEX_bpred_configure(APEX_BranchPredictor* bpred, const char* spec);
+
+int
+APEX_bpred_valid(const APEX_BranchPredictor* bpred, int code_memory_size);
+
+int
+APEX_bpred_predict(APEX_BranchPredictor* bpred, int pc, int op, int imm, uint16_t* counter);
+
+void
+APEX_bpred_update(APEX_BranchPredictor* bpred, int pc, int op, int counter, int taken, int target, int mispredicted);
+
+int
+APEX_ooo_configure(APEX_CPU* cpu, const char* spec);
+
+int
+APEX_ooo_valid(const APEX_CPU* cpu);
+
+int
+APEX_ooo_simulate(APEX_CPU* cpu, int no_of_cycles);
+
+void
+APEX_alu_compute(CPU_Stage* stage);
+
+int
+APEX_cpu_simulate(APEX_CPU* cpu, int no_of_cycles);
+
+int
+APEX_cpu_run(APEX_CPU* cpu, int no_of_cycles, int flag);
+
+long
+APEX_cpu_functional(APEX_CPU* cpu, long no_of_instructions);
+
+int
+APEX_cpu_debug(APEX_CPU* cpu, int no_of_cycles, const char* spec);
+
+void
+APEX_translation_free(struct APEX_Translation* translation);
+
+APEX_JitBuffer*
+APEX_jit_create(void);
+
+void
+APEX_jit_free(APEX_JitBuffer* buffer);
+
+void*
+APEX_jit_compile(APEX_JitBuffer* buffer, const APEX_Instruction* code, int code_memory_size, int start, int length);
+
+int
+APEX_jit_run(void* entry, int* regs, APEX_JitContext* context);
+
+int
+APEX_cpu_save(const APEX_CPU* cpu, const char* path);
+
+APEX_CPU*
+APEX_cpu_load(const char* path);
+
+int
+APEX_is_checkpoint(const char* path);
+
+APEX_Trace*
+APEX_trace_open(const char* path);
+
+void
+APEX_trace_cycle(APEX_Trace* trace, int clock);
+
+void
+APEX_trace_stage(APEX_Trace* trace, int stage_id, const CPU_Stage* stage, int is_active);
+
+int
+APEX_trace_close(APEX_Trace* trace);
+
+FILE*
+APEX_trace_open_reader(const char* path);
+
+int
+APEX_trace_read(FILE* fp, APEX_TraceRecord* record);
+
+int
+APEX_stats_save(const APEX_CPU* cpu, const char* path);
+
+int
+get_code_index(int pc);
+
+int
+APEX_stage_valid(const CPU_Stage* stage);
+
+void
+print_stage_content(const char* name, CPU_Stage* stage, int is_active);
+
+int
+print_register_state(APEX_CPU* cpu);
+
+int
+print_data_memory(APEX_CPU* cpu, uint32_t address, uint32_t count);
+
+void
+APEX_cpu_stop(APEX_CPU* cpu);
+
+int
+fetch(APEX_CPU* cpu);
+
+int
+decode(APEX_CPU* cpu);
+
+int
+execute1(APEX_CPU* cpu);
+
+int
+execute2(APEX_CPU* cpu);
+
+int
+memory1(APEX_CPU* cpu);
+
+int
+memory2(APEX_CPU* cpu);
+
+int
+writeback(APEX_CPU* cpu);
+
+#endif
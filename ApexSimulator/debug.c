@@ -0,0 +1,515 @@
+/*
+ *  debug.c
+ *  Contains the time-travel debugger of apex_sim <input_file> debug <cycles>
+ *
+ *  The debugger first runs the pipeline quietly to the end of the run,
+ *  taking in-memory snapshots of the whole cpu on the way, then reads
+ *  commands from standard input:
+ *
+ *    goto <cycle>                     state after that many cycles
+ *    step [n]                         n cycles forward, 1 by default
+ *    step-back [n]                    n cycles back, 1 by default
+ *    show                             the stages of the latest cycle, as display prints them
+ *    regs                             register state
+ *    mem [<address>:<count>]          data memory, as mem= prints it
+ *    last-write <Rn|CC|MEM[address]>  latest cycle and instruction to write it
+ *    snapshots                        the snapshots kept
+ *    quit
+ *
+ *  A cycle is reached from the nearest snapshot at or before it, or the
+ *  current cycle if that is nearer, by simulating forward: the pipeline
+ *  is deterministic, so a replay goes through exactly the states of the
+ *  first run. A snapshot is taken every SNAPSHOT_INTERVAL cycles, or
+ *  CYCLES_PER_PAGE cycles per page of data memory if that is longer, so
+ *  that copying the memory costs little next to simulating. Snapshots
+ *  share the pages that did not change between them.
+ *
+ *  The snapshots kept are log-spaced. Once there are more of them than
+ *  the limit, or they take more memory, the one whose removal leaves the
+ *  smallest gap relative to its distance from the end of the run, or
+ *  from the cycle last gone to, is dropped. The gap to any cycle then
+ *  grows in proportion to how far it is from both. A replay longer than
+ *  a snapshot interval leaves snapshots behind it, log-spaced back from
+ *  where it stops, so that stepping back from there stays short too.
+ *
+ *  last-write replays the intervals between snapshots backwards from the
+ *  current cycle, with the location watched (see APEX_Watch), until one
+ *  of them writes it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+#define SNAPSHOT_INTERVAL 16384
+#define CYCLES_PER_PAGE 64
+
+/* Limits of snapshots=<count>[:<megabytes>] */
+#define DEFAULT_SNAPSHOTS 256
+#define DEFAULT_MEGABYTES 256
+
+typedef struct SnapshotPage
+{
+  int refs;                // Snapshots holding this copy
+  APEX_MemoryPage page;
+} SnapshotPage;
+
+typedef struct Snapshot
+{
+  APEX_CPU cpu;            // Host pointers in here are stale, see restore
+  SnapshotPage** pages;    // Data memory pages in address order
+  uint32_t num_pages;
+} Snapshot;
+
+typedef struct Debugger
+{
+  APEX_CPU* cpu;
+  long end;                // Cycle the run ends at, once known by its cycle count or the program
+  long frontier;           // Latest cycle simulated so far
+  long next_snapshot;      // Cycle of the next snapshot, always past the frontier
+  long focus;              // Cycle last gone to
+  Snapshot** snapshots;    // In cycle order, the first one is never dropped
+  int count;
+  int max_count;
+  size_t bytes;            // Taken by the snapshots and their pages
+  size_t max_bytes;
+} Debugger;
+
+/* Cycles run so far: the clock, one more once the program has ended the run */
+static long
+cycle_of(const APEX_CPU* cpu)
+{
+  return cpu->stats.cycles;
+}
+
+static void*
+allocate(size_t size)
+{
+  void* p = malloc(size);
+  if (!p) {
+    fprintf(stderr, "APEX_Error : Out of memory for debugger snapshots\n");
+    exit(1);
+  }
+  return p;
+}
+
+static void
+free_snapshot(Debugger* dbg, Snapshot* snapshot)
+{
+  for (uint32_t i = 0; i < snapshot->num_pages; ++i) {
+    if (--snapshot->pages[i]->refs == 0) {
+      free(snapshot->pages[i]);
+      dbg->bytes -= sizeof(SnapshotPage);
+    }
+  }
+  dbg->bytes -= sizeof(*snapshot) + sizeof(*snapshot->pages) * snapshot->num_pages;
+  free(snapshot->pages);
+  free(snapshot);
+}
+
+/* Distance of cycle from the end of the run or the focus, whichever is nearer */
+static long
+distance(const Debugger* dbg, long cycle)
+{
+  long from_end = dbg->frontier - cycle;
+  long from_focus = labs(dbg->focus - cycle);
+  return (from_end < from_focus ? from_end : from_focus) + SNAPSHOT_INTERVAL;
+}
+
+/* Drops snapshots until they are within the limits, keeping the first and the latest */
+static void
+thin(Debugger* dbg)
+{
+  while (dbg->count > 2 && (dbg->count > dbg->max_count || dbg->bytes > dbg->max_bytes)) {
+    int victim = 1;
+    double best = 0;
+    for (int i = 1; i < dbg->count - 1; ++i) {
+      long gap = cycle_of(&dbg->snapshots[i + 1]->cpu) - cycle_of(&dbg->snapshots[i - 1]->cpu);
+      double cost = (double) gap / distance(dbg, cycle_of(&dbg->snapshots[i]->cpu));
+      if (i == 1 || cost < best) {
+        victim = i;
+        best = cost;
+      }
+    }
+    free_snapshot(dbg, dbg->snapshots[victim]);
+    memmove(&dbg->snapshots[victim], &dbg->snapshots[victim + 1], sizeof(Snapshot*) * (dbg->count - victim - 1));
+    dbg->count--;
+  }
+}
+
+static void
+take_snapshot(Debugger* dbg)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  int at = dbg->count;
+  while (at > 0 && cycle_of(&dbg->snapshots[at - 1]->cpu) >= cycle_of(cpu)) {
+    if (cycle_of(&dbg->snapshots[at - 1]->cpu) == cycle_of(cpu)) {
+      return;
+    }
+    at--;
+  }
+
+  uint32_t num_pages;
+  APEX_MemoryPage** pages = APEX_memory_sorted_pages(&cpu->data_memory, &num_pages);
+  if (num_pages && !pages) {
+    fprintf(stderr, "APEX_Error : Out of memory for debugger snapshots\n");
+    exit(1);
+  }
+  Snapshot* snapshot = allocate(sizeof(*snapshot));
+  memcpy(&snapshot->cpu, cpu, sizeof(*cpu));
+  snapshot->pages = allocate(sizeof(*snapshot->pages) * (num_pages ? num_pages : 1));
+  snapshot->num_pages = num_pages;
+  dbg->bytes += sizeof(*snapshot) + sizeof(*snapshot->pages) * num_pages;
+
+  /* Pages that did not change since the previous snapshot are shared with it */
+  const Snapshot* previous = at > 0 ? dbg->snapshots[at - 1] : NULL;
+  uint32_t p = 0;
+  for (uint32_t i = 0; i < num_pages; ++i) {
+    while (previous && p < previous->num_pages && previous->pages[p]->page.number < pages[i]->number) {
+      p++;
+    }
+    SnapshotPage* copy;
+    if (previous && p < previous->num_pages && previous->pages[p]->page.number == pages[i]->number &&
+        memcmp(previous->pages[p]->page.words, pages[i]->words, sizeof(pages[i]->words)) == 0) {
+      copy = previous->pages[p];
+      copy->refs++;
+    } else {
+      copy = allocate(sizeof(*copy));
+      copy->refs = 1;
+      memcpy(&copy->page, pages[i], sizeof(copy->page));
+      dbg->bytes += sizeof(*copy);
+    }
+    snapshot->pages[i] = copy;
+  }
+  free(pages);
+
+  memmove(&dbg->snapshots[at + 1], &dbg->snapshots[at], sizeof(Snapshot*) * (dbg->count - at));
+  dbg->snapshots[at] = snapshot;
+  dbg->count++;
+  thin(dbg);
+}
+
+/* Puts the cpu back in the state of snapshot, keeping its own host resources */
+static void
+restore(Debugger* dbg, const Snapshot* snapshot)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  const APEX_Instruction* code_memory = cpu->code_memory;
+  int owns_code_memory = cpu->owns_code_memory;
+  void* checkpoint_mapping = cpu->checkpoint_mapping;
+  size_t checkpoint_mapping_size = cpu->checkpoint_mapping_size;
+  struct APEX_Trace* trace = cpu->trace;
+  struct APEX_Translation* translation = cpu->translation;
+  int enable_debug_messages = cpu->enable_debug_messages;
+  APEX_Watch watch = cpu->watch;
+  APEX_Memory data_memory = cpu->data_memory;
+  memcpy(cpu, &snapshot->cpu, sizeof(*cpu));
+  cpu->code_memory = code_memory;
+  cpu->owns_code_memory = owns_code_memory;
+  cpu->checkpoint_mapping = checkpoint_mapping;
+  cpu->checkpoint_mapping_size = checkpoint_mapping_size;
+  cpu->trace = trace;
+  cpu->translation = translation;
+  cpu->enable_debug_messages = enable_debug_messages;
+  cpu->watch = watch;
+  cpu->data_memory = data_memory;
+
+  /* Pages first stored to after the snapshot are cleared, which reads
+   * the same as never stored to */
+  uint32_t num_pages;
+  APEX_MemoryPage** pages = APEX_memory_sorted_pages(&cpu->data_memory, &num_pages);
+  if (num_pages && !pages) {
+    fprintf(stderr, "APEX_Error : Out of memory for debugger snapshots\n");
+    exit(1);
+  }
+  uint32_t p = 0;
+  for (uint32_t i = 0; i < num_pages; ++i) {
+    while (p < snapshot->num_pages && snapshot->pages[p]->page.number < pages[i]->number) {
+      p++;
+    }
+    if (p == snapshot->num_pages || snapshot->pages[p]->page.number != pages[i]->number) {
+      memset(pages[i]->words, 0, sizeof(pages[i]->words));
+    }
+  }
+  free(pages);
+  for (uint32_t i = 0; i < snapshot->num_pages; ++i) {
+    const APEX_MemoryPage* copy = &snapshot->pages[i]->page;
+    APEX_MemoryPage* page = APEX_memory_page(&cpu->data_memory, copy->number, 1);
+    memcpy(page->words, copy->words, sizeof(page->words));
+  }
+}
+
+/* Simulates forward to cycle, or the end of the run if that comes first,
+ * taking the snapshots due on the way */
+static void
+advance(Debugger* dbg, long cycle)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  if (cycle > dbg->end) {
+    cycle = dbg->end;
+  }
+  while (cycle_of(cpu) < cycle) {
+    long until = cycle < dbg->next_snapshot ? cycle : dbg->next_snapshot;
+    APEX_cpu_simulate(cpu, until - 1);
+    if (cpu->clock < until) {
+      /* HALT, or the pipeline drained past the last instruction */
+      dbg->end = cycle_of(cpu);
+      cycle = dbg->end;
+    }
+    if (cycle_of(cpu) > dbg->frontier) {
+      dbg->frontier = cycle_of(cpu);
+    }
+    if (cycle_of(cpu) == dbg->next_snapshot) {
+      take_snapshot(dbg);
+      uint32_t pages = cpu->data_memory.count;
+      long interval = (long) pages * CYCLES_PER_PAGE > SNAPSHOT_INTERVAL ? (long) pages * CYCLES_PER_PAGE : SNAPSHOT_INTERVAL;
+      dbg->next_snapshot = cycle_of(cpu) + interval;
+    }
+  }
+}
+
+/* Moves the cpu to cycle, within the first snapshot and the end of the run */
+static void
+go_to(Debugger* dbg, long cycle)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  if (cycle > dbg->end) {
+    cycle = dbg->end;
+  }
+  if (cycle < cycle_of(&dbg->snapshots[0]->cpu)) {
+    cycle = cycle_of(&dbg->snapshots[0]->cpu);
+  }
+  int latest = 0;
+  while (latest + 1 < dbg->count && cycle_of(&dbg->snapshots[latest + 1]->cpu) <= cycle) {
+    latest++;
+  }
+  long from = cycle_of(&dbg->snapshots[latest]->cpu);
+  if (cycle < cycle_of(cpu) || cycle_of(cpu) < from) {
+    restore(dbg, dbg->snapshots[latest]);
+  } else {
+    from = cycle_of(cpu);
+  }
+  dbg->focus = cycle;
+  long back = SNAPSHOT_INTERVAL;
+  while (2 * back < cycle - from) {
+    back *= 2;
+  }
+  for (; back >= SNAPSHOT_INTERVAL && cycle - back > from; back /= 2) {
+    advance(dbg, cycle - back);
+    take_snapshot(dbg);
+  }
+  advance(dbg, cycle);
+}
+
+static void
+print_position(const Debugger* dbg)
+{
+  const APEX_CPU* cpu = dbg->cpu;
+  printf("(apex) >> Cycle %ld of %ld, %d instructions retired%s\n", cycle_of(cpu), dbg->end,
+         cpu->ins_completed, cycle_of(cpu) == dbg->end ? ", end of the run" : "");
+}
+
+/* Finds the latest write before the current cycle to the location watched as in watch */
+static void
+last_write(Debugger* dbg, APEX_Watch watch, const char* name)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  long now = cycle_of(cpu);
+  long to = now;
+  int i = dbg->count - 1;
+  while (i >= 0 && cycle_of(&dbg->snapshots[i]->cpu) >= now) {
+    i--;
+  }
+  for (; i >= 0; --i) {
+    restore(dbg, dbg->snapshots[i]);
+    cpu->watch = watch;
+    advance(dbg, to);
+    if (cpu->watch.writes) {
+      break;
+    }
+    to = cycle_of(&dbg->snapshots[i]->cpu);
+  }
+  watch = cpu->watch;
+  cpu->watch.kind = WATCH_NONE;
+  if (i >= 0) {
+    int index = get_code_index(watch.pc);
+    printf("(apex) >> %s last written in cycle %d by %s at PC %d\n", name, watch.cycle,
+           index >= 0 && index < cpu->code_memory_size ? opcode_info[cpu->code_memory[index].op].name : "?", watch.pc);
+  } else {
+    printf("(apex) >> %s not written since cycle %ld\n", name, cycle_of(&dbg->snapshots[0]->cpu));
+  }
+  go_to(dbg, now);
+}
+
+/* Parses Rn, CC or MEM[address] into watch */
+static int
+parse_location(const char* name, APEX_Watch* watch)
+{
+  char* end;
+  memset(watch, 0, sizeof(*watch));
+  if (strcmp(name, "CC") == 0) {
+    watch->kind = WATCH_REGISTER;
+    watch->reg = CC;
+    return 0;
+  }
+  if (name[0] == 'R') {
+    long reg = strtol(name + 1, &end, 10);
+    if (end != name + 1 && !*end && reg >= 0 && reg < 16) {
+      watch->kind = WATCH_REGISTER;
+      watch->reg = reg;
+      return 0;
+    }
+  } else if (strncmp(name, "MEM[", 4) == 0) {
+    watch->address = strtoul(name + 4, &end, 0);
+    if (end != name + 4 && strcmp(end, "]") == 0) {
+      watch->kind = WATCH_MEMORY;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void
+print_snapshots(const Debugger* dbg)
+{
+  printf("(apex) >> %d snapshots, %.1f MB:", dbg->count, dbg->bytes / 1048576.0);
+  for (int i = 0; i < dbg->count; ++i) {
+    printf(" %ld", cycle_of(&dbg->snapshots[i]->cpu));
+  }
+  printf("\n");
+}
+
+/* Runs one command line, returns 1 on quit */
+static int
+run_command(Debugger* dbg, char* line)
+{
+  APEX_CPU* cpu = dbg->cpu;
+  char* save_ptr = NULL;
+  char* command = strtok_r(line, " \t\r\n", &save_ptr);
+  char* argument = strtok_r(NULL, " \t\r\n", &save_ptr);
+  if (!command) {
+    return 0;
+  }
+  long n = argument ? strtol(argument, NULL, 0) : 1;
+  if (strcmp(command, "quit") == 0 || strcmp(command, "q") == 0) {
+    return 1;
+  } else if (strcmp(command, "goto") == 0 && argument) {
+    go_to(dbg, n);
+    print_position(dbg);
+  } else if (strcmp(command, "step") == 0) {
+    go_to(dbg, cycle_of(cpu) + n);
+    print_position(dbg);
+  } else if (strcmp(command, "step-back") == 0) {
+    go_to(dbg, cycle_of(cpu) - n);
+    print_position(dbg);
+  } else if (strcmp(command, "show") == 0) {
+    long now = cycle_of(cpu);
+    if (now <= cycle_of(&dbg->snapshots[0]->cpu)) {
+      printf("(apex) >> No cycle before cycle %ld to show\n", now);
+      return 0;
+    }
+    go_to(dbg, now - 1);
+    cpu->enable_debug_messages = 1;
+    advance(dbg, now);
+    cpu->enable_debug_messages = 0;
+  } else if (strcmp(command, "regs") == 0) {
+    print_register_state(cpu);
+  } else if (strcmp(command, "mem") == 0) {
+    uint32_t address = 0;
+    uint32_t count = 0;
+    if (argument) {
+      char* end;
+      address = strtoul(argument, &end, 0);
+      if (*end == ':') {
+        count = strtoul(end + 1, &end, 0);
+      }
+      if (*end || count == 0) {
+        printf("(apex) >> Invalid data memory range %s\n", argument);
+        return 0;
+      }
+    }
+    print_data_memory(cpu, address, count);
+  } else if (strcmp(command, "last-write") == 0 && argument) {
+    APEX_Watch watch;
+    if (parse_location(argument, &watch) != 0) {
+      printf("(apex) >> Unknown location %s, expected Rn, CC or MEM[address]\n", argument);
+      return 0;
+    }
+    last_write(dbg, watch, argument);
+  } else if (strcmp(command, "snapshots") == 0) {
+    print_snapshots(dbg);
+  } else {
+    printf("(apex) >> Commands: goto <cycle>, step [n], step-back [n], show, regs, mem [<address>:<count>],\n"
+           "(apex) >>           last-write <Rn|CC|MEM[address]>, snapshots, quit\n");
+  }
+  return 0;
+}
+
+/*
+ * Runs the pipeline for no_of_cycles as APEX_cpu_run does, then serves
+ * the commands of standard input, see the top of this file. spec is
+ * snapshots=<count>[:<megabytes>], NULL for the defaults. Returns -1 if
+ * spec is not valid.
+ */
+int
+APEX_cpu_debug(APEX_CPU* cpu, int no_of_cycles, const char* spec)
+{
+  Debugger dbg;
+  memset(&dbg, 0, sizeof(dbg));
+  dbg.cpu = cpu;
+  dbg.max_count = DEFAULT_SNAPSHOTS;
+  dbg.max_bytes = (size_t) DEFAULT_MEGABYTES << 20;
+  if (spec) {
+    char* end;
+    long count = strtol(spec, &end, 0);
+    long megabytes = DEFAULT_MEGABYTES;
+    if (*end == ':') {
+      megabytes = strtol(end + 1, &end, 0);
+    }
+    if (*end || count < 2 || megabytes < 1) {
+      return -1;
+    }
+    dbg.max_count = count;
+    dbg.max_bytes = (size_t) megabytes << 20;
+  }
+  dbg.snapshots = allocate(sizeof(Snapshot*) * (dbg.max_count + 1));
+
+  /* The run ends where apex_sim simulate would stop */
+  cpu->enable_debug_messages = 0;
+  cpu->watch.kind = WATCH_NONE;
+  dbg.end = (long) no_of_cycles + 1;
+  dbg.frontier = cycle_of(cpu);
+  dbg.next_snapshot = cycle_of(cpu);
+  dbg.focus = dbg.end;
+  if (dbg.end < dbg.frontier) {
+    dbg.end = dbg.frontier;
+  }
+  take_snapshot(&dbg);
+  dbg.next_snapshot = cycle_of(cpu) + SNAPSHOT_INTERVAL;
+  advance(&dbg, dbg.end);
+  printf("(apex) >> Simulation Complete\n");
+  print_position(&dbg);
+
+  int interactive = isatty(STDIN_FILENO);
+  char* line = NULL;
+  size_t len = 0;
+  for (;;) {
+    if (interactive) {
+      printf("(apex-debug) ");
+      fflush(stdout);
+    }
+    if (getline(&line, &len, stdin) == -1 || run_command(&dbg, line)) {
+      break;
+    }
+    fflush(stdout);
+  }
+  free(line);
+
+  for (int i = 0; i < dbg.count; ++i) {
+    free_snapshot(&dbg, dbg.snapshots[i]);
+  }
+  free(dbg.snapshots);
+  return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ *  file_parser.c
+ *  Contains functions to parse input file and create
+ *  code memory, you can edit this file to add new instructions
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+/*
+ * Reads a register number or literal the way atoi would, after the
+ * one-character prefix (R or #) of the operand between p and end
+ */
+static int
+get_num_from_string(const char* p, const char* end)
+{
+  if (p < end) {
+    ++p;
+  }
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    ++p;
+  }
+  int negative = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+')) {
+    ++p;
+  }
+  unsigned value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p++ - '0');
+  }
+  return negative ? -(int) value : (int) value;
+}
+
+/* Mnemonic and operand classes of every opcode, indexed by APEX_Opcode */
+const APEX_OpcodeInfo opcode_info[NUM_OPCODES] = {
+  [OP_NONE] = { "", 0 },
+  [OP_MOVC] = { "MOVC", OPF_RD | OPF_IMM },
+  [OP_ADD] = { "ADD", OPF_RD | OPF_RS1 | OPF_RS2 | OPF_SETS_CC },
+  [OP_ADDL] = { "ADDL", OPF_RD | OPF_RS1 | OPF_IMM | OPF_SETS_CC },
+  [OP_SUB] = { "SUB", OPF_RD | OPF_RS1 | OPF_RS2 | OPF_SETS_CC },
+  [OP_SUBL] = { "SUBL", OPF_RD | OPF_RS1 | OPF_IMM | OPF_SETS_CC },
+  [OP_MUL] = { "MUL", OPF_RD | OPF_RS1 | OPF_RS2 | OPF_SETS_CC },
+  [OP_AND] = { "AND", OPF_RD | OPF_RS1 | OPF_RS2 },
+  [OP_OR] = { "OR", OPF_RD | OPF_RS1 | OPF_RS2 },
+  [OP_EXOR] = { "EX-OR", OPF_RD | OPF_RS1 | OPF_RS2 },
+  [OP_LOAD] = { "LOAD", OPF_RD | OPF_RS1 | OPF_IMM | OPF_LOAD },
+  [OP_LDR] = { "LDR", OPF_RD | OPF_RS1 | OPF_RS2 | OPF_LOAD },
+  [OP_STORE] = { "STORE", OPF_RS1 | OPF_RS2 | OPF_IMM | OPF_STORE },
+  [OP_STR] = { "STR", OPF_RS1 | OPF_RS2 | OPF_RS3 | OPF_STORE },
+  [OP_BZ] = { "BZ", OPF_IMM | OPF_BRANCH },
+  [OP_BNZ] = { "BNZ", OPF_IMM | OPF_BRANCH },
+  [OP_JUMP] = { "JUMP", OPF_RS1 | OPF_IMM | OPF_BRANCH },
+  [OP_HALT] = { "HALT", 0 },
+  [OP_NOP] = { "NOP", 0 },
+};
+
+/* Maps a mnemonic to its opcode, OP_NONE if it is not part of the ISA */
+static int
+lookup_opcode(const char* name, size_t length)
+{
+  for (int op = OP_NONE + 1; op < NUM_OPCODES; ++op) {
+    if (strlen(opcode_info[op].name) == length && memcmp(opcode_info[op].name, name, length) == 0) {
+      return op;
+    }
+  }
+  return OP_NONE;
+}
+
+/* Fields of an instruction: the mnemonic and up to five operands */
+#define MAX_TOKENS 6
+
+/*
+ * Decodes the line between line and end, without its newline, into ins.
+ * Fields are separated by commas, empty ones are skipped.
+ *
+ * Note : you can edit this function to add new instructions
+ */
+static void
+create_APEX_instruction(APEX_Instruction* ins, const char* line, const char* end)
+{
+  const char* token[MAX_TOKENS];
+  const char* token_end[MAX_TOKENS];
+  int token_num = 0;
+  const char* p = line;
+  while (token_num < MAX_TOKENS) {
+    while (p < end && *p == ',') {
+      ++p;
+    }
+    if (p == end) {
+      break;
+    }
+    token[token_num] = p;
+    p = memchr(p, ',', end - p);
+    p = p ? p : end;
+    token_end[token_num++] = p;
+  }
+
+  /* A missing operand reads as 0 */
+  for (int i = token_num; i < MAX_TOKENS; ++i) {
+    token[i] = token_end[i] = end;
+  }
+
+  ins->rd = -1; ins->rs1 = -1; ins->rs2 = -1; ins->rs3 = -1; ins->imm = -1; 
+
+  /* Opcode is decoded once here, the pipeline stages only look at op and op_flags */
+  const char* cr = memchr(token[0], '\r', token_end[0] - token[0]);
+  ins->op = lookup_opcode(token[0], (cr ? cr : token_end[0]) - token[0]);
+  ins->op_flags = opcode_info[ins->op].flags;
+
+  /* Operands appear in the order rd, rs1, rs2, rs3, literal for every opcode */
+  int next = 1;
+  if (ins->op_flags & OPF_RD) {
+    ins->rd = get_num_from_string(token[next], token_end[next]);
+    next++;
+  }
+  if (ins->op_flags & OPF_RS1) {
+    ins->rs1 = get_num_from_string(token[next], token_end[next]);
+    next++;
+  }
+  if (ins->op_flags & OPF_RS2) {
+    ins->rs2 = get_num_from_string(token[next], token_end[next]);
+    next++;
+  }
+  if (ins->op_flags & OPF_RS3) {
+    ins->rs3 = get_num_from_string(token[next], token_end[next]);
+    next++;
+  }
+  if (ins->op_flags & OPF_IMM) {
+    ins->imm = get_num_from_string(token[next], token_end[next]);
+  }
+}
+
+/*
+ * Decodes every line of the program text, length bytes that need not end
+ * in a NUL, in a single pass. Returns the code memory, with its number
+ * of instructions in *size, or NULL if the text has no line.
+ */
+APEX_Instruction*
+parse_code_memory(const char* text, size_t length, int* size)
+{
+  const char* end = text + length;
+  APEX_Instruction* code_memory = NULL;
+  int capacity = 0;
+  int code_memory_size = 0;
+
+  //store the instruction in the array, one instruction in each line
+  for (const char* line = text; line < end;) {
+    const char* newline = memchr(line, '\n', end - line);
+    const char* line_end = newline ? newline : end;
+    if (code_memory_size == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      APEX_Instruction* grown = realloc(code_memory, sizeof(*code_memory) * capacity);
+      if (!grown) {
+        free(code_memory);
+        *size = 0;
+        return NULL;
+      }
+      code_memory = grown;
+    }
+    create_APEX_instruction(&code_memory[code_memory_size++], line, line_end);
+    line = newline ? newline + 1 : end;
+  }
+
+  *size = code_memory_size;
+  if (!code_memory_size) {
+    return NULL;
+  }
+  APEX_Instruction* fitted = realloc(code_memory, sizeof(*code_memory) * code_memory_size);
+  return fitted ? fitted : code_memory;
+}
+
+/* Whether a register field names R0-R15 or CC, or may be unused (-1) where op_flags does not name it */
+static int
+register_valid(int reg, int used)
+{
+  return reg >= (used ? 0 : -1) && reg <= 16;
+}
+
+/*
+ * Whether the fields of a decoded instruction, in code memory or in a
+ * latch, can index opcode_info and the register file: the opcode is in
+ * range, op_flags are its operand classes and every register field is
+ * one the stages may read or write.
+ */
+int
+APEX_operands_valid(int op, int op_flags, int rd, int rs1, int rs2, int rs3)
+{
+  return op >= 0 && op < NUM_OPCODES && op_flags == opcode_info[op].flags &&
+         register_valid(rd, op_flags & OPF_RD) && register_valid(rs1, op_flags & OPF_RS1) &&
+         register_valid(rs2, op_flags & OPF_RS2) && register_valid(rs3, op_flags & OPF_RS3);
+}
+
+/*
+ * Checks code memory that was not decoded by this run, from a program
+ * image or a checkpoint, before the pipeline indexes opcode_info and the
+ * register file with its fields. Returns 1 if every instruction could
+ * have come from parse_code_memory, 0 otherwise.
+ */
+int
+APEX_code_memory_valid(const APEX_Instruction* code_memory, int code_memory_size)
+{
+  for (int i = 0; i < code_memory_size; ++i) {
+    const APEX_Instruction* ins = &code_memory[i];
+    if (!APEX_operands_valid(ins->op, ins->op_flags, ins->rd, ins->rs1, ins->rs2, ins->rs3)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Maps the text of filename into memory, read only. Returns NULL, with
+ * *length 0, if it cannot be mapped or is empty.
+ */
+const char*
+map_program_text(const char* filename, size_t* length)
+{
+  *length = 0;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  char* text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
+    return NULL;
+  }
+  madvise(text, st.st_size, MADV_SEQUENTIAL);
+  *length = st.st_size;
+  return text;
+}
+
+/*
+ * This function parses the input file into code memory, mapped rather
+ * than read line by line, see parse_code_memory
+ */
+APEX_Instruction*
+create_code_memory(const char* filename, int* size)
+{
+  *size = 0;
+  if (!filename) {
+    return NULL;
+  }
+
+  size_t length;
+  const char* text = map_program_text(filename, &length);
+  if (!text) {
+    return NULL;
+  }
+  APEX_Instruction* code_memory = parse_code_memory(text, length, size);
+  munmap((void*) text, length);
+  return code_memory;
+}
@@ -0,0 +1,350 @@
+/*
+ *  functional.c
+ *  Contains the functional (ISA level) APEX interpreter
+ *
+ *  Instructions are executed one at a time with architectural semantics
+ *  only: no latches, no hazards, no cycles. It works directly on the
+ *  registers, CC flag, data memory and PC of an APEX_CPU, so a run can be
+ *  fast-forwarded here and then continued cycle by cycle in the pipeline.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* Longest block; a longer run of straight-line code is split in blocks
+ * that chain into each other */
+#define MAX_BLOCK_LENGTH 64
+
+/* Pseudo-opcode that ends a block not ending in a branch or HALT */
+#define OP_CHAIN NUM_OPCODES
+
+/* A pre-decoded instruction, with the address of the code that executes it */
+typedef struct ThreadedOp
+{
+  const void* handler;
+  int imm;
+  int8_t rd;
+  int8_t rs1;
+  int8_t rs2;
+  int8_t rs3;
+} ThreadedOp;
+
+/* A basic block: straight-line code up to and including a BZ, BNZ, JUMP
+ * or HALT, or of MAX_BLOCK_LENGTH instructions followed by an OP_CHAIN */
+typedef struct Block
+{
+  int start;                  // Code memory index of the first instruction
+  int length;                 // Instructions, OP_CHAIN not included
+  int target;                 // Index a taken BZ/BNZ goes to, -1 if it is not an instruction
+  struct Block* taken;        // Chained successors, NULL until first followed;
+  struct Block* fall_through; // taken is the latest target of a JUMP
+  int heat;                   // Entries so far, up to the JIT threshold
+  void* native;               // Compiled code, NULL until the block is hot
+  ThreadedOp ops[];
+} Block;
+
+typedef struct APEX_Translation
+{
+  const APEX_Instruction* code_memory; // Code the blocks were translated from
+  int code_memory_size;
+  Block** block_at;                    // Block starting at each index, NULL until translated
+  void** native_at;                    // Its native code, NULL until compiled; one past the end
+  APEX_JitBuffer* jit;                 // Where that code lives, NULL if there is no JIT
+} APEX_Translation;
+
+void
+APEX_translation_free(APEX_Translation* translation)
+{
+  if (!translation) {
+    return;
+  }
+  for (int index = 0; index < translation->code_memory_size; ++index) {
+    free(translation->block_at[index]);
+  }
+  free(translation->block_at);
+  free(translation->native_at);
+  APEX_jit_free(translation->jit);
+  free(translation);
+}
+
+/* Returns 1 if pc is the address of an instruction, as EX2 checks a branch target */
+static int
+valid_target(const APEX_Translation* translation, int pc)
+{
+  int ins_index = get_code_index(pc);
+  return pc % 4 == 0 && ins_index < translation->code_memory_size && ins_index >= 0;
+}
+
+static int
+ends_block(int op)
+{
+  return op == OP_BZ || op == OP_BNZ || op == OP_JUMP || op == OP_HALT;
+}
+
+/*
+ * Returns the block starting at index, translating it on first use.
+ * handlers holds the code of every opcode in APEX_cpu_functional.
+ */
+static Block*
+block_at(APEX_Translation* translation, int index, const void* const* handlers)
+{
+  if (translation->block_at[index]) {
+    return translation->block_at[index];
+  }
+  const APEX_Instruction* code = translation->code_memory;
+  int end = index;
+  while (end < translation->code_memory_size && end - index < MAX_BLOCK_LENGTH && !ends_block(code[end++].op)) {
+  }
+  int chains = !ends_block(code[end - 1].op);
+  Block* block = calloc(1, sizeof(*block) + sizeof(ThreadedOp) * (end - index + chains));
+  if (!block) {
+    fprintf(stderr, "APEX_Error : Out of memory for the translation cache\n");
+    exit(1);
+  }
+  block->start = index;
+  block->length = end - index;
+  block->target = -1;
+  for (int i = 0; i < block->length; ++i) {
+    const APEX_Instruction* ins = &code[index + i];
+    ThreadedOp* op = &block->ops[i];
+    op->handler = handlers[ins->op];
+    op->imm = ins->imm;
+    op->rd = ins->rd;
+    op->rs1 = ins->rs1;
+    op->rs2 = ins->rs2;
+    op->rs3 = ins->rs3;
+  }
+  if (chains) {
+    block->ops[block->length].handler = handlers[OP_CHAIN];
+  }
+  const APEX_Instruction* last = &code[end - 1];
+  if ((last->op == OP_BZ || last->op == OP_BNZ) && valid_target(translation, 4000 + (end - 1) * 4 + last->imm)) {
+    block->target = get_code_index(4000 + (end - 1) * 4 + last->imm);
+  }
+  translation->block_at[index] = block;
+  return block;
+}
+
+/* The translation of the code memory of cpu, new or flushed if the code memory changed */
+static APEX_Translation*
+translation_of(APEX_CPU* cpu)
+{
+  APEX_Translation* translation = cpu->translation;
+  if (translation && translation->code_memory == cpu->code_memory &&
+      translation->code_memory_size == cpu->code_memory_size) {
+    return translation;
+  }
+  APEX_translation_free(translation);
+  translation = calloc(1, sizeof(*translation));
+  Block** blocks = calloc(cpu->code_memory_size, sizeof(*blocks));
+  void** natives = calloc(cpu->code_memory_size + 1, sizeof(*natives));
+  if (!translation || !blocks || !natives) {
+    fprintf(stderr, "APEX_Error : Out of memory for the translation cache\n");
+    exit(1);
+  }
+  translation->code_memory = cpu->code_memory;
+  translation->code_memory_size = cpu->code_memory_size;
+  translation->block_at = blocks;
+  translation->native_at = natives;
+  translation->jit = cpu->jit_threshold > 0 ? APEX_jit_create() : NULL;
+  cpu->translation = translation;
+  return translation;
+}
+
+/*
+ * Executes up to no_of_instructions instructions starting at cpu->pc.
+ * Stops early, leaving the PC on it, when the next instruction is HALT,
+ * or when the PC runs past the end of code memory. The pipeline must be
+ * empty, i.e. the cpu was just created or has only run functionally.
+ *
+ * The code memory is executed as threaded code: every basic block is
+ * translated once into ops that jump straight to the code of the next
+ * one, and the end of a block straight to the block it went to the last
+ * time. The budget is only checked between blocks; a block it does not
+ * cover entirely runs from a copy cut short. A block entered
+ * cpu->jit_threshold times is compiled to native code, see jit.c, which
+ * runs in its place from then on. The blocks are kept with the cpu
+ * until its code memory changes.
+ *
+ * Returns the number of instructions executed.
+ */
+long
+APEX_cpu_functional(APEX_CPU* cpu, long no_of_instructions)
+{
+  static const void* const handlers[NUM_OPCODES + 1] = {
+    [OP_NONE] = &&op_nop,
+    [OP_MOVC] = &&op_movc,
+    [OP_ADD] = &&op_add,
+    [OP_ADDL] = &&op_addl,
+    [OP_SUB] = &&op_sub,
+    [OP_SUBL] = &&op_subl,
+    [OP_MUL] = &&op_mul,
+    [OP_AND] = &&op_and,
+    [OP_OR] = &&op_or,
+    [OP_EXOR] = &&op_exor,
+    [OP_LOAD] = &&op_load,
+    [OP_LDR] = &&op_ldr,
+    [OP_STORE] = &&op_store,
+    [OP_STR] = &&op_str,
+    [OP_BZ] = &&op_bz,
+    [OP_BNZ] = &&op_bnz,
+    [OP_JUMP] = &&op_jump,
+    [OP_HALT] = &&op_halt,
+    [OP_NOP] = &&op_nop,
+    [OP_CHAIN] = &&op_chain,
+  };
+  int* regs = cpu->regs;
+  APEX_Memory* mem = &cpu->data_memory;
+  int index = get_code_index(cpu->pc);
+  long executed = 0;
+  if (no_of_instructions <= 0 || index < 0 || index >= cpu->code_memory_size) {
+    return 0;
+  }
+  APEX_Translation* translation = translation_of(cpu);
+  Block* block = block_at(translation, index, handlers);
+  ThreadedOp partial[MAX_BLOCK_LENGTH + 1];
+  const ThreadedOp* op;
+  int taken;
+  APEX_JitContext context = { 0, (void* const*) translation->native_at, mem };
+
+#define NEXT() goto *(++op)->handler
+
+enter:
+  if (block->heat < cpu->jit_threshold && ++block->heat == cpu->jit_threshold) {
+    block->native = APEX_jit_compile(translation->jit, translation->code_memory, translation->code_memory_size,
+                                     block->start, block->length);
+    translation->native_at[block->start] = block->native;
+  }
+  if (block->native && no_of_instructions - executed >= block->length) {
+    /* Native code goes on from block to block while it can */
+    context.remaining = no_of_instructions - executed;
+    index = APEX_jit_run(block->native, regs, &context);
+    assert(index >= 0); // Branched to an address that is not an instruction
+    executed = no_of_instructions - context.remaining;
+    if (index >= translation->code_memory_size || executed >= no_of_instructions) {
+      goto done;
+    }
+    block = block_at(translation, index, handlers);
+    goto enter;
+  }
+  if (no_of_instructions - executed >= block->length) {
+    op = block->ops;
+  } else {
+    /* The last block of the budget ends where the budget does */
+    int length = no_of_instructions - executed;
+    memcpy(partial, block->ops, sizeof(ThreadedOp) * length);
+    partial[length].handler = &&leave;
+    op = partial;
+  }
+  goto *op->handler;
+
+op_movc:
+  regs[op->rd] = op->imm;
+  NEXT();
+op_add:
+  regs[op->rd] = regs[op->rs1] + regs[op->rs2];
+  regs[CC] = (regs[op->rd] == 0);
+  NEXT();
+op_addl:
+  regs[op->rd] = regs[op->rs1] + op->imm;
+  regs[CC] = (regs[op->rd] == 0);
+  NEXT();
+op_sub:
+  regs[op->rd] = regs[op->rs1] - regs[op->rs2];
+  regs[CC] = (regs[op->rd] == 0);
+  NEXT();
+op_subl:
+  regs[op->rd] = regs[op->rs1] - op->imm;
+  regs[CC] = (regs[op->rd] == 0);
+  NEXT();
+op_mul:
+  regs[op->rd] = regs[op->rs1] * regs[op->rs2];
+  regs[CC] = (regs[op->rd] == 0);
+  NEXT();
+op_and:
+  regs[op->rd] = regs[op->rs1] & regs[op->rs2];
+  NEXT();
+op_or:
+  regs[op->rd] = regs[op->rs1] | regs[op->rs2];
+  NEXT();
+op_exor:
+  regs[op->rd] = regs[op->rs1] ^ regs[op->rs2];
+  NEXT();
+op_load:
+  regs[op->rd] = APEX_memory_read(mem, regs[op->rs1] + op->imm);
+  NEXT();
+op_ldr:
+  regs[op->rd] = APEX_memory_read(mem, regs[op->rs1] + regs[op->rs2]);
+  NEXT();
+op_store:
+  APEX_memory_write(mem, regs[op->rs2] + op->imm, regs[op->rs1]);
+  NEXT();
+op_str:
+  APEX_memory_write(mem, regs[op->rs2] + regs[op->rs3], regs[op->rs1]);
+  NEXT();
+op_nop:
+  NEXT();
+
+op_bz:
+  taken = regs[CC] == 1;
+  goto branch;
+op_bnz:
+  taken = regs[CC] != 1;
+branch:
+  executed += block->length;
+  if (taken) {
+    assert(block->target >= 0);
+    if (!block->taken) {
+      block->taken = block_at(translation, block->target, handlers);
+    }
+    block = block->taken;
+    goto next_block;
+  }
+  goto fall_through;
+op_chain:
+  executed += block->length;
+fall_through:
+  index = block->start + block->length;
+  if (index >= translation->code_memory_size) {
+    goto done;
+  }
+  if (!block->fall_through) {
+    block->fall_through = block_at(translation, index, handlers);
+  }
+  block = block->fall_through;
+next_block:
+  if (executed < no_of_instructions) {
+    goto enter;
+  }
+  index = block->start;
+  goto done;
+
+op_jump:
+  executed += block->length;
+  assert(valid_target(translation, regs[op->rs1] + op->imm));
+  index = get_code_index(regs[op->rs1] + op->imm);
+  if (!block->taken || block->taken->start != index) {
+    block->taken = block_at(translation, index, handlers);
+  }
+  block = block->taken;
+  goto next_block;
+
+op_halt:
+  /* HALT itself is left for the pipeline, or the next call, to find */
+  executed += block->length - 1;
+  index = block->start + block->length - 1;
+  goto done;
+
+leave:
+  /* Out of budget inside the block */
+  executed += op - partial;
+  index = block->start + (op - partial);
+
+#undef NEXT
+done:
+  cpu->pc = 4000 + index * 4;
+  cpu->ins_fast_forwarded += executed;
+  return executed;
+}
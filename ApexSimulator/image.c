@@ -0,0 +1,194 @@
+/*
+ *  image.c
+ *  Contains the cache of pre-decoded program images
+ *
+ *  A program parsed with a cache directory is stored there as
+ *
+ *    <cache_dir>/<hash>.apexo
+ *
+ *  where hash is a 64-bit hash of the program text, in hex. The image
+ *  is an APEX_ImageHeader followed, 64 byte aligned, by the code memory
+ *  exactly as create_code_memory builds it. The next run of the same
+ *  text, under any file name, only hashes the mapped text and reads the
+ *  code memory back, with no parsing at all. An image of another build,
+ *  of a text of another length, or whose code memory does not match its
+ *  checksum or holds an instruction the parser cannot produce, is
+ *  ignored and rewritten. A different text of the same length and hash
+ *  is not told apart, the 64-bit hash makes that unlikely.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.h"
+
+#define IMAGE_MAGIC "APEXOIMG"
+
+/* Bump whenever APEX_Instruction, the header or the way a line decodes changes */
+#define IMAGE_VERSION 2
+
+typedef struct APEX_ImageHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t instruction_size;  // sizeof(APEX_Instruction) of the writer
+  uint32_t code_memory_size;  // Number of instructions
+  uint32_t unused;
+  uint64_t text_hash;
+  uint64_t text_length;       // Bytes of program text
+  uint64_t code_offset;
+  uint64_t code_hash;         // hash_text of the code memory bytes
+} APEX_ImageHeader;
+
+/* Hashes 8 bytes at a time, the text is hashed on every run */
+static uint64_t
+hash_text(const char* text, size_t length)
+{
+  uint64_t hash = 0x9e3779b97f4a7c15ull ^ length;
+  size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, text + i, sizeof(word));
+    hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  for (; i < length; ++i) {
+    hash = (hash ^ (unsigned char) text[i]) * 0x100000001b3ull;
+  }
+  hash ^= hash >> 29;
+  return hash;
+}
+
+static int
+read_fully(int fd, void* data, size_t size)
+{
+  char* p = data;
+  while (size) {
+    ssize_t n = read(fd, p, size);
+    if (n <= 0) {
+      return -1;
+    }
+    p += n;
+    size -= n;
+  }
+  return 0;
+}
+
+/*
+ * Reads the code memory of the image at path if it holds text_hash and
+ * text_length and its code memory is intact
+ */
+static APEX_Instruction*
+read_image(const char* path, uint64_t text_hash, uint64_t text_length, int* size)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  APEX_ImageHeader header;
+  struct stat st;
+  APEX_Instruction* code_memory = NULL;
+  if (read_fully(fd, &header, sizeof(header)) == 0 && fstat(fd, &st) == 0 &&
+      memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) == 0 &&
+      header.version == IMAGE_VERSION &&
+      header.instruction_size == sizeof(APEX_Instruction) &&
+      header.text_hash == text_hash && header.text_length == text_length &&
+      header.code_memory_size > 0 &&
+      header.code_offset + (uint64_t) header.code_memory_size * sizeof(APEX_Instruction) == (uint64_t) st.st_size &&
+      lseek(fd, header.code_offset, SEEK_SET) == (off_t) header.code_offset) {
+    code_memory = malloc(sizeof(*code_memory) * header.code_memory_size);
+    size_t code_size = sizeof(*code_memory) * header.code_memory_size;
+    if (code_memory &&
+        (read_fully(fd, code_memory, code_size) != 0 ||
+         hash_text((const char*) code_memory, code_size) != header.code_hash ||
+         !APEX_code_memory_valid(code_memory, header.code_memory_size))) {
+      free(code_memory);
+      code_memory = NULL;
+    }
+  }
+  close(fd);
+  if (code_memory) {
+    *size = header.code_memory_size;
+  }
+  return code_memory;
+}
+
+/* Writes the image through a temporary file, so that a reader never sees half of one */
+static int
+write_image(const char* path, uint64_t text_hash, uint64_t text_length,
+            const APEX_Instruction* code_memory, int code_memory_size)
+{
+  APEX_ImageHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.version = IMAGE_VERSION;
+  header.instruction_size = sizeof(APEX_Instruction);
+  header.code_memory_size = code_memory_size;
+  header.text_hash = text_hash;
+  header.text_length = text_length;
+  header.code_offset = 64;
+  header.code_hash = hash_text((const char*) code_memory, sizeof(*code_memory) * code_memory_size);
+
+  char temporary[4096];
+  if (snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid()) >= (int) sizeof(temporary)) {
+    return -1;
+  }
+  FILE* fp = fopen(temporary, "wb");
+  if (!fp) {
+    return -1;
+  }
+  static const char padding[64];
+  int result = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+               fwrite(padding, header.code_offset - sizeof(header), 1, fp) == 1 &&
+               fwrite(code_memory, sizeof(*code_memory), code_memory_size, fp) == (size_t) code_memory_size
+                 ? 0 : -1;
+  if (fclose(fp) != 0) {
+    result = -1;
+  }
+  if (result == 0 && rename(temporary, path) != 0) {
+    result = -1;
+  }
+  if (result != 0) {
+    unlink(temporary);
+  }
+  return result;
+}
+
+/*
+ * Creates the code memory of filename like create_code_memory. With a
+ * cache_dir, takes it from the image of the same text there if there
+ * is one, and otherwise parses the text and leaves an image behind.
+ */
+APEX_Instruction*
+APEX_load_program(const char* filename, const char* cache_dir, int* size)
+{
+  if (!cache_dir) {
+    return create_code_memory(filename, size);
+  }
+  *size = 0;
+  size_t length;
+  const char* text = filename ? map_program_text(filename, &length) : NULL;
+  if (!text) {
+    return NULL;
+  }
+  uint64_t text_hash = hash_text(text, length);
+  char path[4096];
+  APEX_Instruction* code_memory = NULL;
+  if (snprintf(path, sizeof(path), "%s/%016llx.apexo", cache_dir, (unsigned long long) text_hash) < (int) sizeof(path)) {
+    code_memory = read_image(path, text_hash, length, size);
+    if (!code_memory) {
+      code_memory = parse_code_memory(text, length, size);
+      if (code_memory && write_image(path, text_hash, length, code_memory, *size) != 0) {
+        fprintf(stderr, "APEX_Error : Unable to write program image %s\n", path);
+      }
+    }
+  } else {
+    code_memory = parse_code_memory(text, length, size);
+  }
+  munmap((void*) text, length);
+  return code_memory;
+}
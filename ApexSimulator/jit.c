@@ -0,0 +1,406 @@
+/*
+ *  jit.c
+ *  Contains the x86-64 compiler of hot basic blocks
+ *
+ *  The functional interpreter hands a block here once it has been
+ *  entered often enough, see APEX_cpu_functional. The block becomes
+ *  native code in an executable buffer that is called as
+ *
+ *    int block(int* regs, APEX_JitContext* context)
+ *
+ *  with the registers and CC of the cpu in regs. Every block starts by
+ *  taking its instructions off context->remaining, and returns the code
+ *  memory index to go on from right away if the budget does not cover
+ *  it. At its end a block jumps straight into the native code of the
+ *  block it goes to, found in context->native_at, and only returns to
+ *  the interpreter, with the index of that block, when there is none.
+ *  A HALT is never compiled: the block returns the index of the HALT.
+ *  A branch or JUMP to an address that is not an instruction returns -1.
+ *
+ *  Registers live in regs and are used as memory operands, so they stay
+ *  in the L1 of the host. LOAD, LDR, STORE and STR look at the page of
+ *  the previous access inline and call APEX_memory_read or
+ *  APEX_memory_write on any other; every 32-bit address is valid.
+ *
+ *  On another host, or if no executable memory can be had, nothing is
+ *  compiled and everything keeps running as threaded code.
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cpu.h"
+
+/* Executable memory of one translation */
+#define JIT_BUFFER_SIZE (4 << 20)
+
+/* Longest native code of one instruction, memory accesses included */
+#define JIT_MAX_INSTRUCTION_BYTES 128
+
+struct APEX_JitBuffer
+{
+  uint8_t* code;
+  size_t size;
+  size_t used;
+};
+
+APEX_JitBuffer*
+APEX_jit_create(void)
+{
+#if defined(__x86_64__)
+  APEX_JitBuffer* buffer = calloc(1, sizeof(*buffer));
+  if (!buffer) {
+    return NULL;
+  }
+  buffer->code = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer->code == MAP_FAILED) {
+    free(buffer);
+    return NULL;
+  }
+  buffer->size = JIT_BUFFER_SIZE;
+  return buffer;
+#else
+  return NULL;
+#endif
+}
+
+void
+APEX_jit_free(APEX_JitBuffer* buffer)
+{
+  if (buffer) {
+    munmap(buffer->code, buffer->size);
+    free(buffer);
+  }
+}
+
+#if defined(__x86_64__)
+
+static void
+emit(APEX_JitBuffer* buffer, const uint8_t* bytes, size_t count)
+{
+  memcpy(buffer->code + buffer->used, bytes, count);
+  buffer->used += count;
+}
+
+#define EMIT(...) do { const uint8_t bytes_[] = { __VA_ARGS__ }; emit(buffer, bytes_, sizeof(bytes_)); } while (0)
+
+static void
+emit32(APEX_JitBuffer* buffer, uint32_t value)
+{
+  emit(buffer, (const uint8_t*) &value, sizeof(value));
+}
+
+static void
+emit64(APEX_JitBuffer* buffer, uint64_t value)
+{
+  emit(buffer, (const uint8_t*) &value, sizeof(value));
+}
+
+/* Emits a jump or jcc with a rel32 to fill in by land(), returns where */
+static size_t
+jump(APEX_JitBuffer* buffer, uint8_t opcode)
+{
+  if (opcode == 0xE9) {
+    EMIT(0xE9);
+  } else {
+    EMIT(0x0F, opcode);
+  }
+  emit32(buffer, 0);
+  return buffer->used - 4;
+}
+
+/* Makes the jump emitted at rel32 land at the current position */
+static void
+land(APEX_JitBuffer* buffer, size_t rel32)
+{
+  int32_t offset = buffer->used - (rel32 + 4);
+  memcpy(buffer->code + rel32, &offset, sizeof(offset));
+}
+
+enum
+{
+  JCC_JAE = 0x83,
+  JCC_JE = 0x84,
+  JCC_JNE = 0x85,
+  JCC_JL = 0x8C,
+  JMP = 0xE9,
+};
+
+/* Displacement of a register in regs, always a disp8 */
+#define REG(r) ((uint8_t) (4 * (r)))
+
+/* mov eax, imm32; ret */
+static void
+emit_return(APEX_JitBuffer* buffer, int index)
+{
+  EMIT(0xB8);
+  emit32(buffer, index);
+  EMIT(0xC3);
+}
+
+/* Goes on at the code memory index in ecx: into its native code if it
+ * has any, back to the interpreter otherwise */
+static void
+emit_chain(APEX_JitBuffer* buffer)
+{
+  EMIT(0x48, 0x8B, 0x56, offsetof(APEX_JitContext, native_at)); // mov rdx, [rsi+native_at]
+  EMIT(0x48, 0x8B, 0x14, 0xCA);                                 // mov rdx, [rdx+rcx*8]
+  EMIT(0x48, 0x85, 0xD2);                                       // test rdx, rdx
+  EMIT(0x74, 0x02);                                             // jz +2
+  EMIT(0xFF, 0xE2);                                             // jmp rdx
+  EMIT(0x89, 0xC8);                                             // mov eax, ecx
+  EMIT(0xC3);                                                   // ret
+}
+
+/* Goes on at a code memory index known now */
+static void
+emit_goto(APEX_JitBuffer* buffer, int index, int code_memory_size)
+{
+  if (index >= code_memory_size) {
+    emit_return(buffer, index);
+    return;
+  }
+  EMIT(0xB9);                                                   // mov ecx, index
+  emit32(buffer, index);
+  emit_chain(buffer);
+}
+
+/* regs[CC] = eax == 0 */
+static void
+emit_cc(APEX_JitBuffer* buffer)
+{
+  EMIT(0x85, 0xC0);             // test eax, eax
+  EMIT(0x0F, 0x94, 0xC1);       // sete cl
+  EMIT(0x0F, 0xB6, 0xC9);       // movzx ecx, cl
+  EMIT(0x89, 0x4F, REG(CC));    // mov [rdi+CC], ecx
+}
+
+/*
+ * Reads (eax = memory[ecx]) or writes (memory[ecx] = eax) a data memory
+ * word. Clobbers ecx, edx, r8 and r9.
+ */
+static void
+emit_memory(APEX_JitBuffer* buffer, int is_write)
+{
+  EMIT(0x4C, 0x8B, 0x46, offsetof(APEX_JitContext, memory)); // mov r8, [rsi+memory]
+  EMIT(0x4D, 0x8B, 0x48, offsetof(APEX_Memory, last));       // mov r9, [r8+last]
+  EMIT(0x4D, 0x85, 0xC9);                                    // test r9, r9
+  size_t no_page = jump(buffer, JCC_JE);
+  EMIT(0x89, 0xCA);                                          // mov edx, ecx
+  EMIT(0xC1, 0xEA, APEX_PAGE_BITS);                          // shr edx, APEX_PAGE_BITS
+  EMIT(0x41, 0x39, 0x11);                                    // cmp [r9+number], edx
+  size_t other_page = jump(buffer, JCC_JNE);
+  EMIT(0x89, 0xCA);                                          // mov edx, ecx
+  EMIT(0x81, 0xE2);                                          // and edx, APEX_PAGE_WORDS - 1
+  emit32(buffer, APEX_PAGE_WORDS - 1);
+  if (is_write) {
+    EMIT(0x41, 0x89, 0x44, 0x91, offsetof(APEX_MemoryPage, words)); // mov [r9+rdx*4+words], eax
+  } else {
+    EMIT(0x41, 0x8B, 0x44, 0x91, offsetof(APEX_MemoryPage, words)); // mov eax, [r9+rdx*4+words]
+  }
+  size_t done = jump(buffer, JMP);
+
+  land(buffer, no_page);
+  land(buffer, other_page);
+  EMIT(0x57, 0x56);                                          // push rdi; push rsi
+  EMIT(0x48, 0x83, 0xEC, 0x08);                              // sub rsp, 8
+  EMIT(0x4C, 0x89, 0xC7);                                    // mov rdi, r8
+  EMIT(0x89, 0xCE);                                          // mov esi, ecx
+  if (is_write) {
+    EMIT(0x89, 0xC2);                                        // mov edx, eax
+  }
+  EMIT(0x48, 0xB8);                                          // mov rax, helper
+  emit64(buffer, (uint64_t) (uintptr_t) (is_write ? (void*) APEX_memory_write : (void*) APEX_memory_read));
+  EMIT(0xFF, 0xD0);                                          // call rax
+  EMIT(0x48, 0x83, 0xC4, 0x08);                              // add rsp, 8
+  EMIT(0x5E, 0x5F);                                          // pop rsi; pop rdi
+  land(buffer, done);
+}
+
+/* Returns 1 if every register ins names is one of R0 to R15 */
+static int
+compilable(const APEX_Instruction* ins)
+{
+  int flags = ins->op_flags;
+  return (!(flags & OPF_RD) || (ins->rd >= 0 && ins->rd < CC)) &&
+         (!(flags & OPF_RS1) || (ins->rs1 >= 0 && ins->rs1 < CC)) &&
+         (!(flags & OPF_RS2) || (ins->rs2 >= 0 && ins->rs2 < CC)) &&
+         (!(flags & OPF_RS3) || (ins->rs3 >= 0 && ins->rs3 < CC));
+}
+
+/* Emits an instruction that is neither a branch nor HALT */
+static void
+emit_instruction(APEX_JitBuffer* buffer, const APEX_Instruction* ins)
+{
+  switch (ins->op) {
+  case OP_MOVC:
+    EMIT(0xC7, 0x47, REG(ins->rd));           // mov dword [rdi+rd], imm
+    emit32(buffer, ins->imm);
+    break;
+  case OP_ADD:
+  case OP_SUB:
+  case OP_MUL:
+  case OP_AND:
+  case OP_OR:
+  case OP_EXOR:
+    EMIT(0x8B, 0x47, REG(ins->rs1));          // mov eax, [rdi+rs1]
+    switch (ins->op) {
+    case OP_ADD:
+      EMIT(0x03, 0x47, REG(ins->rs2));        // add eax, [rdi+rs2]
+      break;
+    case OP_SUB:
+      EMIT(0x2B, 0x47, REG(ins->rs2));        // sub eax, [rdi+rs2]
+      break;
+    case OP_MUL:
+      EMIT(0x0F, 0xAF, 0x47, REG(ins->rs2));  // imul eax, [rdi+rs2]
+      break;
+    case OP_AND:
+      EMIT(0x23, 0x47, REG(ins->rs2));        // and eax, [rdi+rs2]
+      break;
+    case OP_OR:
+      EMIT(0x0B, 0x47, REG(ins->rs2));        // or eax, [rdi+rs2]
+      break;
+    default:
+      EMIT(0x33, 0x47, REG(ins->rs2));        // xor eax, [rdi+rs2]
+      break;
+    }
+    EMIT(0x89, 0x47, REG(ins->rd));           // mov [rdi+rd], eax
+    if (ins->op_flags & OPF_SETS_CC) {
+      emit_cc(buffer);
+    }
+    break;
+  case OP_ADDL:
+  case OP_SUBL:
+    EMIT(0x8B, 0x47, REG(ins->rs1));          // mov eax, [rdi+rs1]
+    EMIT(ins->op == OP_ADDL ? 0x05 : 0x2D);   // add/sub eax, imm
+    emit32(buffer, ins->imm);
+    EMIT(0x89, 0x47, REG(ins->rd));           // mov [rdi+rd], eax
+    emit_cc(buffer);
+    break;
+  case OP_LOAD:
+  case OP_LDR:
+    EMIT(0x8B, 0x4F, REG(ins->rs1));          // mov ecx, [rdi+rs1]
+    if (ins->op == OP_LOAD) {
+      EMIT(0x81, 0xC1);                       // add ecx, imm
+      emit32(buffer, ins->imm);
+    } else {
+      EMIT(0x03, 0x4F, REG(ins->rs2));        // add ecx, [rdi+rs2]
+    }
+    emit_memory(buffer, 0);
+    EMIT(0x89, 0x47, REG(ins->rd));           // mov [rdi+rd], eax
+    break;
+  case OP_STORE:
+  case OP_STR:
+    EMIT(0x8B, 0x47, REG(ins->rs1));          // mov eax, [rdi+rs1]
+    EMIT(0x8B, 0x4F, REG(ins->rs2));          // mov ecx, [rdi+rs2]
+    if (ins->op == OP_STORE) {
+      EMIT(0x81, 0xC1);                       // add ecx, imm
+      emit32(buffer, ins->imm);
+    } else {
+      EMIT(0x03, 0x4F, REG(ins->rs3));        // add ecx, [rdi+rs3]
+    }
+    emit_memory(buffer, 1);
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * Compiles the block of length instructions at start of code, which
+ * ends with its only BZ, BNZ, JUMP or HALT, if any. Returns its entry
+ * point, or NULL if it cannot be compiled or the buffer is full.
+ */
+void*
+APEX_jit_compile(APEX_JitBuffer* buffer, const APEX_Instruction* code, int code_memory_size, int start, int length)
+{
+  if (!buffer) {
+    return NULL;
+  }
+  const APEX_Instruction* last = &code[start + length - 1];
+  /* The HALT is left to the interpreter */
+  int native_length = last->op == OP_HALT ? length - 1 : length;
+  if (native_length <= 0 || buffer->used + (size_t) (length + 2) * JIT_MAX_INSTRUCTION_BYTES > buffer->size) {
+    return NULL;
+  }
+  for (int i = start; i < start + length; ++i) {
+    if (!compilable(&code[i])) {
+      return NULL;
+    }
+  }
+
+  void* entry = buffer->code + buffer->used;
+  EMIT(0x48, 0x81, 0x3E);                      // cmp qword [rsi+remaining], native_length
+  emit32(buffer, native_length);
+  size_t short_budget = jump(buffer, JCC_JL);
+  EMIT(0x48, 0x81, 0x2E);                      // sub qword [rsi+remaining], native_length
+  emit32(buffer, native_length);
+
+  for (int i = start; i < start + length; ++i) {
+    const APEX_Instruction* ins = &code[i];
+    if (ins->op == OP_HALT) {
+      emit_return(buffer, i);
+    } else if (ins->op == OP_BZ || ins->op == OP_BNZ) {
+      int pc = 4000 + i * 4 + ins->imm;
+      int target = get_code_index(pc);
+      EMIT(0x83, 0x7F, REG(CC), 0x01);          // cmp dword [rdi+CC], 1
+      size_t not_taken = jump(buffer, ins->op == OP_BZ ? JCC_JNE : JCC_JE);
+      if (pc % 4 == 0 && target >= 0 && target < code_memory_size) {
+        emit_goto(buffer, target, code_memory_size);
+      } else {
+        emit_return(buffer, -1);
+      }
+      land(buffer, not_taken);
+      emit_goto(buffer, i + 1, code_memory_size);
+    } else if (ins->op == OP_JUMP) {
+      EMIT(0x8B, 0x47, REG(ins->rs1));          // mov eax, [rdi+rs1]
+      EMIT(0x05);                               // add eax, imm
+      emit32(buffer, ins->imm);
+      EMIT(0xA8, 0x03);                         // test al, 3
+      size_t unaligned = jump(buffer, JCC_JNE);
+      EMIT(0x2D);                               // sub eax, 4000
+      emit32(buffer, 4000);
+      EMIT(0xC1, 0xF8, 0x02);                   // sar eax, 2
+      EMIT(0x3D);                               // cmp eax, code_memory_size
+      emit32(buffer, code_memory_size);
+      size_t outside = jump(buffer, JCC_JAE);
+      EMIT(0x89, 0xC1);                         // mov ecx, eax
+      emit_chain(buffer);
+      land(buffer, unaligned);
+      land(buffer, outside);
+      emit_return(buffer, -1);
+    } else {
+      emit_instruction(buffer, ins);
+    }
+  }
+  if (last->op != OP_BZ && last->op != OP_BNZ && last->op != OP_JUMP && last->op != OP_HALT) {
+    emit_goto(buffer, start + length, code_memory_size);
+  }
+
+  land(buffer, short_budget);
+  emit_return(buffer, start);
+  return entry;
+}
+
+#else
+
+void*
+APEX_jit_compile(APEX_JitBuffer* buffer, const APEX_Instruction* code, int code_memory_size, int start, int length)
+{
+  return NULL;
+}
+
+#endif
+
+/*
+ * Runs native code from entry on. Returns the code memory index the
+ * interpreter goes on from, -1 for a branch to an invalid address.
+ */
+int
+APEX_jit_run(void* entry, int* regs, APEX_JitContext* context)
+{
+  int (*block)(int*, APEX_JitContext*) = (int (*)(int*, APEX_JitContext*)) entry;
+  return block(regs, context);
+}
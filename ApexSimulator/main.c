@@ -0,0 +1,238 @@
+/*
+ *  main.c
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int
+main(int argc, char const* argv[])
+{
+  /* save=, trace=, stats=<path>, policy=<name>, width=<n>, unit=, bpred=, icache=, dcache=, ooo=<spec>, mem=<range>, cache=<dir>, jit=<n> and snapshots=<spec> may appear anywhere, everything else is positional */
+  const char* args[5];
+  int num_args = 0;
+  const char* save_path = NULL;
+  const char* trace_path = NULL;
+  const char* stats_path = NULL;
+  const char* policy_name = NULL;
+  const char* bpred_spec = NULL;
+  const char* icache_spec = NULL;
+  const char* dcache_spec = NULL;
+  const char* width = NULL;
+  const char* ooo_spec = NULL;
+  const char* mem_range = NULL;
+  const char* cache_dir = NULL;
+  const char* jit_threshold = NULL;
+  const char* snapshots_spec = NULL;
+  for (int i = 0; i < argc; ++i) {
+    if (strncmp(argv[i], "save=", 5) == 0) {
+      save_path = argv[i] + 5;
+    } else if (strncmp(argv[i], "trace=", 6) == 0) {
+      trace_path = argv[i] + 6;
+    } else if (strncmp(argv[i], "stats=", 6) == 0) {
+      stats_path = argv[i] + 6;
+    } else if (strncmp(argv[i], "policy=", 7) == 0) {
+      policy_name = argv[i] + 7;
+    } else if (strncmp(argv[i], "bpred=", 6) == 0) {
+      bpred_spec = argv[i] + 6;
+    } else if (strncmp(argv[i], "icache=", 7) == 0) {
+      icache_spec = argv[i] + 7;
+    } else if (strncmp(argv[i], "dcache=", 7) == 0) {
+      dcache_spec = argv[i] + 7;
+    } else if (strncmp(argv[i], "ooo=", 4) == 0) {
+      ooo_spec = argv[i] + 4;
+    } else if (strncmp(argv[i], "jit=", 4) == 0) {
+      jit_threshold = argv[i] + 4;
+    } else if (strncmp(argv[i], "snapshots=", 10) == 0) {
+      snapshots_spec = argv[i] + 10;
+    } else if (strncmp(argv[i], "cache=", 6) == 0) {
+      cache_dir = argv[i] + 6;
+    } else if (strncmp(argv[i], "mem=", 4) == 0) {
+      mem_range = argv[i] + 4;
+    } else if (strncmp(argv[i], "width=", 6) == 0) {
+      width = argv[i] + 6;
+    } else if (strncmp(argv[i], "unit=", 5) == 0) {
+      /* Applied once the cpu exists */
+    } else if (num_args < 5) {
+      args[num_args++] = argv[i];
+    } else {
+      num_args = 0;
+      break;
+    }
+  }
+  if (num_args != 4 && num_args != 5) {
+    fprintf(stderr, "APEX_Help : Usage %s <input_file|checkpoint> function cycles [fast_forward] [save=<checkpoint>] [trace=<file>] [stats=<file>] [policy=<name>] [width=<n>] [unit=<spec>]... [bpred=<spec>] [icache=<spec>] [dcache=<spec>] [ooo=<spec>] [mem=<address>:<count>] [cache=<dir>] [jit=<n>] [snapshots=<spec>]\n", argv[0]);
+    fprintf(stderr, "APEX_Help : function is simulate, display, functional or debug. fast_forward\n"
+                    "            instructions are executed functionally before the pipeline\n"
+                    "            takes over. In functional mode, cycles is the instruction budget.\n"
+                    "            debug runs the pipeline quietly, then reads commands from\n"
+                    "            standard input to go back and forth in the run: goto <cycle>,\n"
+                    "            step [n], step-back [n], show, regs, mem [<address>:<count>],\n"
+                    "            last-write <Rn|CC|MEM[address]>, snapshots and quit.\n"
+                    "            snapshots= bounds the snapshots it keeps to go back with,\n"
+                    "            <count>[:<megabytes>], 256:256 by default.\n"
+                    "            save= writes the final cpu state, which can be given back\n"
+                    "            in place of the input file to continue the run.\n"
+                    "            trace= records the pipeline of every cycle to a binary\n"
+                    "            file instead of printing it, see apex_trace.\n"
+                    "            stats= writes the pipeline statistics counters, as CSV\n"
+                    "            if the file name ends in .csv, as JSON otherwise.\n"
+                    "            policy= selects how decode resolves hazards: interlock,\n"
+                    "            forward or forward_lu. apex_sim_<policy> is specialized\n"
+                    "            for one policy and only accepts that one.\n"
+                    "            width= fetches, decodes and executes up to n instructions\n"
+                    "            per cycle, at most 4, with one memory port. Defaults to 1.\n"
+                    "            unit= sets the timing of a functional unit as\n"
+                    "            <alu|mul|mem>:<latency>[:<interval>], e.g. mul:4 for a\n"
+                    "            pipelined and mul:4:4 for a blocking multiplier. Every\n"
+                    "            unit defaults to 1:1.\n"
+                    "            bpred= selects the branch predictor of fetch,\n"
+                    "            <none|static|bimodal|gshare>[:<table_bits>[:<btb_entries>\n"
+                    "            [:<history_bits>]]], e.g. bpred=gshare:12:256. none, the\n"
+                    "            default, always falls through.\n"
+                    "            dcache= puts an L1 data cache in front of the data memory,\n"
+                    "            <size>:<ways>:<line>:<miss_penalty>[:lru|plru][:wb|wt] with\n"
+                    "            size and line in words, e.g. dcache=256:4:4:10. A miss\n"
+                    "            holds MEM1 for miss_penalty more cycles. There is none\n"
+                    "            by default.\n"
+                    "            icache= puts an L1 instruction cache in front of the code\n"
+                    "            memory, same format with line in instructions. A miss\n"
+                    "            stalls fetch for miss_penalty cycles.\n"
+                    "            ooo= replaces EX1 to WB by an out-of-order engine,\n"
+                    "            <rob>[:<iq>[:<prf>]] entries, e.g. ooo=64:16:96. The issue\n"
+                    "            queue defaults to half the ROB, the physical registers to\n"
+                    "            17 plus two per ROB entry. It issues and commits width\n"
+                    "            instructions per cycle.\n"
+                    "            mem= prints count words of data memory from address on\n"
+                    "            at the end, e.g. mem=0:100. By default every word that\n"
+                    "            is not 0 in the pages the program has stored to.\n"
+                    "            cache= keeps a pre-decoded image of every program in\n"
+                    "            dir, named by a hash of its text, and loads it from\n"
+                    "            there instead of parsing the text again.\n"
+                    "            jit= compiles a block of the functional interpreter to\n"
+                    "            x86-64 code once it has run n times, 64 by default.\n"
+                    "            jit=0 keeps interpreting everything.\n");
+    exit(1);
+  }
+  int no_of_cycles = strtol(args[3], NULL, 0);
+  long fast_forward = (num_args == 5) ? strtol(args[4], NULL, 0) : 0;
+  const char* function = args[2];
+  uint32_t mem_address = 0;
+  uint32_t mem_count = 0;
+  if (mem_range) {
+    char* end;
+    mem_address = strtoul(mem_range, &end, 0);
+    if (*end == ':') {
+      mem_count = strtoul(end + 1, &end, 0);
+    }
+    if (*end || mem_count == 0) {
+      fprintf(stderr, "APEX_Error : Invalid data memory range %s\n", mem_range);
+      exit(1);
+    }
+  }
+  int simulate = 0;
+  int functional = 0;
+  int debug = 0;
+  if(strcmp(function, "simulate") == 0) {
+    simulate = 1;
+  } else if(strcmp(function, "functional") == 0) {
+    functional = 1;
+  } else if(strcmp(function, "debug") == 0) {
+    debug = 1;
+  }
+  if (debug && trace_path) {
+    fprintf(stderr, "APEX_Error : trace= does not apply to debug\n");
+    exit(1);
+  }
+  /* A checkpoint resumes where it was saved, anything else is parsed as a program */
+  APEX_CPU* cpu = APEX_is_checkpoint(args[1]) ? APEX_cpu_load(args[1]) : APEX_cpu_init(args[1], cache_dir);
+  if (!cpu) {
+    fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
+    exit(1);
+  }
+  if (policy_name && APEX_cpu_set_hazard_policy(cpu, APEX_hazard_policy_from_name(policy_name)) != 0) {
+    fprintf(stderr, "APEX_Error : Hazard policy %s is not available in this build\n", policy_name);
+    exit(1);
+  }
+  if (jit_threshold) {
+    char* end;
+    long threshold = strtol(jit_threshold, &end, 0);
+    if (*end || threshold < 0 || threshold > INT_MAX) {
+      fprintf(stderr, "APEX_Error : Invalid JIT threshold %s\n", jit_threshold);
+      exit(1);
+    }
+    cpu->jit_threshold = threshold;
+  }
+  if (width && APEX_cpu_set_width(cpu, strtol(width, NULL, 0)) != 0) {
+    fprintf(stderr, "APEX_Error : Invalid width %s\n", width);
+    exit(1);
+  }
+  for (int i = 0; i < argc; ++i) {
+    if (strncmp(argv[i], "unit=", 5) == 0 && APEX_set_unit(cpu->units, argv[i] + 5) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid functional unit %s\n", argv[i] + 5);
+      exit(1);
+    }
+  }
+  if (bpred_spec && APEX_bpred_configure(&cpu->bpred, bpred_spec) != 0) {
+    fprintf(stderr, "APEX_Error : Invalid branch predictor %s\n", bpred_spec);
+    exit(1);
+  }
+  if (icache_spec && APEX_cache_configure(&cpu->icache, icache_spec) != 0) {
+    fprintf(stderr, "APEX_Error : Invalid instruction cache %s\n", icache_spec);
+    exit(1);
+  }
+  if (dcache_spec && APEX_cache_configure(&cpu->dcache, dcache_spec) != 0) {
+    fprintf(stderr, "APEX_Error : Invalid data cache %s\n", dcache_spec);
+    exit(1);
+  }
+  if (ooo_spec && APEX_ooo_configure(cpu, ooo_spec) != 0) {
+    fprintf(stderr, "APEX_Error : Invalid out-of-order engine %s, or the pipeline has already run\n", ooo_spec);
+    exit(1);
+  }
+
+  if (functional) {
+    APEX_cpu_functional(cpu, no_of_cycles);
+    printf("(apex) >> Functional Simulation Complete, %ld instructions\n", cpu->ins_fast_forwarded);
+    print_register_state(cpu);
+  } else {
+    /* Registers, CC and data memory carry over into the pipeline model */
+    if (fast_forward > 0) {
+      APEX_cpu_functional(cpu, fast_forward);
+    }
+    if (debug) {
+      if (APEX_cpu_debug(cpu, no_of_cycles, snapshots_spec) != 0) {
+        fprintf(stderr, "APEX_Error : Invalid snapshots %s\n", snapshots_spec);
+        exit(1);
+      }
+    } else {
+      if (trace_path) {
+        cpu->trace = APEX_trace_open(trace_path);
+        if (!cpu->trace) {
+          fprintf(stderr, "APEX_Error : Unable to open trace %s\n", trace_path);
+          exit(1);
+        }
+      }
+      APEX_cpu_run(cpu, no_of_cycles, simulate);
+      if (cpu->trace && APEX_trace_close(cpu->trace) != 0) {
+        fprintf(stderr, "APEX_Error : Unable to write trace %s\n", trace_path);
+      }
+      cpu->trace = NULL;
+    }
+  }
+  print_data_memory(cpu, mem_address, mem_count);
+  if (stats_path && APEX_stats_save(cpu, stats_path) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to write statistics %s\n", stats_path);
+  }
+  if (save_path && APEX_cpu_save(cpu, save_path) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to save checkpoint %s\n", save_path);
+  }
+  APEX_cpu_stop(cpu);
+  return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ *  memory.c
+ *  Contains the sparse data memory
+ *
+ *  The data memory covers every 32-bit word address, in pages of
+ *  APEX_PAGE_WORDS words that are only allocated once a store writes to
+ *  them, so a cpu costs host memory for the pages its program touches and
+ *  nothing for the rest. The pages are found through an open-addressing
+ *  hash table on the page number; LOAD and STR usually hit the page of the
+ *  previous access, which cpu.h checks inline before coming here.
+ *
+ *  The cores of a multi-core system share one APEX_SharedMemory: a flat
+ *  table of every page of the address space, which stays virtual memory
+ *  the host only backs where it is touched. Each core keeps its own hash
+ *  table and last page in front of it, so the hot path is the same as
+ *  for one cpu; only the first access of a core to a page comes down to
+ *  the shared table, and a page two cores allocate at once is settled
+ *  by compare-and-swap.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* Table slots a first store allocates */
+#define MIN_CAPACITY 16
+
+static uint32_t
+slot_of(uint32_t number, uint32_t capacity)
+{
+  /* Fibonacci hashing spreads runs of consecutive pages */
+  return (number * 2654435769u) & (capacity - 1);
+}
+
+static void
+insert(APEX_MemoryPage** table, uint32_t capacity, APEX_MemoryPage* page)
+{
+  uint32_t slot = slot_of(page->number, capacity);
+  while (table[slot]) {
+    slot = (slot + 1) & (capacity - 1);
+  }
+  table[slot] = page;
+}
+
+/* Doubles the table once it is half full, keeping probe runs short */
+static void
+grow(APEX_Memory* memory)
+{
+  uint32_t capacity = memory->capacity ? memory->capacity * 2 : MIN_CAPACITY;
+  APEX_MemoryPage** table = calloc(capacity, sizeof(*table));
+  if (!table) {
+    fprintf(stderr, "APEX_Error : Out of memory for the data memory page table\n");
+    exit(1);
+  }
+  for (uint32_t slot = 0; slot < memory->capacity; ++slot) {
+    if (memory->table[slot]) {
+      insert(table, capacity, memory->table[slot]);
+    }
+  }
+  free(memory->table);
+  memory->table = table;
+  memory->capacity = capacity;
+}
+
+static APEX_MemoryPage*
+new_page(uint32_t number)
+{
+  APEX_MemoryPage* page = calloc(1, sizeof(*page));
+  if (!page) {
+    fprintf(stderr, "APEX_Error : Out of memory for data memory page %u\n", number);
+    exit(1);
+  }
+  page->number = number;
+  return page;
+}
+
+/* Page number of shared, allocated if allocate is set and no core did yet */
+static APEX_MemoryPage*
+shared_page(APEX_SharedMemory* shared, uint32_t number, int allocate)
+{
+  APEX_MemoryPage* page = __atomic_load_n(&shared->pages[number], __ATOMIC_ACQUIRE);
+  if (page || !allocate) {
+    return page;
+  }
+  page = new_page(number);
+  APEX_MemoryPage* expected = NULL;
+  if (!__atomic_compare_exchange_n(&shared->pages[number], &expected, page, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    /* Another core got there first */
+    free(page);
+    page = expected;
+  }
+  return page;
+}
+
+/*
+ * Returns the page with the given number and makes it the one the next
+ * access looks at first. A page that does not exist yet is allocated,
+ * zeroed, if allocate is set; otherwise NULL is returned.
+ */
+APEX_MemoryPage*
+APEX_memory_page(APEX_Memory* memory, uint32_t number, int allocate)
+{
+  if (memory->capacity) {
+    uint32_t slot = slot_of(number, memory->capacity);
+    while (memory->table[slot]) {
+      if (memory->table[slot]->number == number) {
+        memory->last = memory->table[slot];
+        return memory->last;
+      }
+      slot = (slot + 1) & (memory->capacity - 1);
+    }
+  }
+  APEX_MemoryPage* page = NULL;
+  if (memory->shared) {
+    page = shared_page(memory->shared, number, allocate);
+    if (!page) {
+      return NULL;
+    }
+  } else if (!allocate) {
+    return NULL;
+  }
+
+  if (2 * (memory->count + 1) > memory->capacity) {
+    grow(memory);
+  }
+  if (!page) {
+    page = new_page(number);
+  }
+  insert(memory->table, memory->capacity, page);
+  memory->count++;
+  memory->last = page;
+  return page;
+}
+
+static int
+compare_pages(const void* a, const void* b)
+{
+  uint32_t x = (*(APEX_MemoryPage* const*) a)->number;
+  uint32_t y = (*(APEX_MemoryPage* const*) b)->number;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Returns a malloc'd array of the allocated pages in address order and
+ * sets count to their number, those of every core for a shared memory.
+ * Returns NULL if there are none or the array cannot be allocated.
+ */
+APEX_MemoryPage**
+APEX_memory_sorted_pages(const APEX_Memory* memory, uint32_t* count)
+{
+  const APEX_SharedMemory* shared = memory->shared;
+  *count = memory->count;
+  if (shared) {
+    *count = 0;
+    for (uint32_t number = 0; number < APEX_NUM_PAGES; ++number) {
+      *count += shared->pages[number] != NULL;
+    }
+  }
+  APEX_MemoryPage** pages = *count ? malloc(sizeof(*pages) * *count) : NULL;
+  if (!pages) {
+    return NULL;
+  }
+  uint32_t n = 0;
+  if (shared) {
+    /* The shared table is in address order already */
+    for (uint32_t number = 0; number < APEX_NUM_PAGES; ++number) {
+      if (shared->pages[number]) {
+        pages[n++] = shared->pages[number];
+      }
+    }
+    return pages;
+  }
+  for (uint32_t slot = 0; slot < memory->capacity; ++slot) {
+    if (memory->table[slot]) {
+      pages[n++] = memory->table[slot];
+    }
+  }
+  qsort(pages, n, sizeof(*pages), compare_pages);
+  return pages;
+}
+
+/* Frees the pages of a private memory, only the table of a core of a shared one */
+void
+APEX_memory_free(APEX_Memory* memory)
+{
+  for (uint32_t slot = 0; !memory->shared && slot < memory->capacity; ++slot) {
+    free(memory->table[slot]);
+  }
+  free(memory->table);
+  memset(memory, 0, sizeof(*memory));
+}
+
+APEX_SharedMemory*
+APEX_shared_memory_create(void)
+{
+  APEX_SharedMemory* shared = malloc(sizeof(*shared));
+  if (!shared) {
+    return NULL;
+  }
+  shared->pages = calloc(APEX_NUM_PAGES, sizeof(*shared->pages));
+  if (!shared->pages) {
+    free(shared);
+    return NULL;
+  }
+  return shared;
+}
+
+/* Frees shared and its pages, once no core uses them any more */
+void
+APEX_shared_memory_free(APEX_SharedMemory* shared)
+{
+  if (!shared) {
+    return;
+  }
+  for (uint32_t number = 0; number < APEX_NUM_PAGES; ++number) {
+    free(shared->pages[number]);
+  }
+  free(shared->pages);
+  free(shared);
+}
@@ -0,0 +1,339 @@
+/*
+ *  mp.c
+ *  Runs a multi-core APEX system, each core on a host thread of its own
+ *
+ *  Usage : apex_mp <cycles> <input_file>... [cores=<n>] [quantum=<n>] [id=<register>]
+ *                  [mem=<address>:<count>] [policy=<name>] [width=<n>] [unit=<spec>]...
+ *                  [bpred=<spec>] [icache=<spec>] [dcache=<spec>] [ooo=<spec>] [cache=<dir>]
+ *
+ *  The system has one core per input file unless cores= says otherwise,
+ *  at most 32; core n runs input file n modulo the number of files, so
+ *  a single file with cores= runs one kernel on every core. With id=,
+ *  every core starts with its core number in that register, e.g. id=R15,
+ *  to pick its share of the work. The cores share one data memory (see
+ *  memory.c), and each has a private L1 data cache, dcache= or
+ *  256:4:4:10 by default, kept coherent by MESI (see coherence.c). The
+ *  other options configure every core the way apex_sim does.
+ *
+ *  The cores synchronize at a barrier every quantum cycles, 1000 unless
+ *  quantum= says otherwise, so no core runs more than a quantum ahead of
+ *  another. Within a quantum the accesses of different cores interleave
+ *  as their host threads happen to run: a kernel whose cores share data
+ *  without synchronizing on it may differ in result and timing from one
+ *  run to the next. A smaller quantum narrows that skew, at the cost of
+ *  more barriers.
+ *
+ *  Output : one CSV row per core, then the data memory as apex_sim prints it
+ *
+ *    core,input_file,policy,cycles,retired,R0,...,R15,CC,dcache_hits,dcache_misses,
+ *    coherence_misses,upgrades,interventions,writebacks
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* Cores of the sharer mask of a coherence directory entry */
+#define MAX_CORES 32
+
+#define DEFAULT_DCACHE "256:4:4:10"
+#define DEFAULT_QUANTUM 1000
+
+/* A parsed program, shared read-only by every core that runs it */
+typedef struct Program
+{
+  const char* filename;
+  APEX_Instruction* code_memory;
+  int code_memory_size;
+} Program;
+
+typedef struct Core
+{
+  struct System* system;
+  APEX_CPU* cpu;
+  int program;
+  int finished; // Halted, drained or out of cycles
+} Core;
+
+typedef struct System
+{
+  int no_of_cycles;
+  int quantum;
+  int num_cores;
+  int running;  // Cores not finished yet
+  pthread_barrier_t barrier;
+} System;
+
+static void*
+core_main(void* arg)
+{
+  Core* core = arg;
+  System* system = core->system;
+  for (long limit = system->quantum; ; limit += system->quantum) {
+    if (!core->finished) {
+      int until = limit - 1 < system->no_of_cycles ? limit - 1 : system->no_of_cycles;
+      APEX_cpu_simulate(core->cpu, until);
+      /* The simulation loop only returns before the clock passes until
+       * once the program is done */
+      if (core->cpu->halted || core->cpu->clock <= until || until == system->no_of_cycles) {
+        core->finished = 1;
+        __atomic_sub_fetch(&system->running, 1, __ATOMIC_ACQ_REL);
+      }
+    }
+    /* Every core has run the quantum; all of them read running before
+     * any of them can change it in the next one */
+    pthread_barrier_wait(&system->barrier);
+    int running = __atomic_load_n(&system->running, __ATOMIC_ACQUIRE);
+    pthread_barrier_wait(&system->barrier);
+    if (!running) {
+      return NULL;
+    }
+  }
+}
+
+/* Register number of R<n> or <n>, -1 if it is none */
+static int
+parse_register(const char* name)
+{
+  char* end;
+  long reg = strtol(name[0] == 'R' || name[0] == 'r' ? name + 1 : name, &end, 10);
+  return *end || end == name || reg < 0 || reg > 15 ? -1 : reg;
+}
+
+static void
+print_core(FILE* out, const Program* programs, const Core* core, int index)
+{
+  const APEX_CPU* cpu = core->cpu;
+  fprintf(out, "%d,%s,%s,%d,%d", index, programs[core->program].filename,
+          hazard_policy_names[cpu->hazard_policy], cpu->clock, cpu->ins_completed);
+  for (int i = 0; i < 17; ++i) {
+    fprintf(out, ",%d", cpu->regs[i]);
+  }
+  fprintf(out, ",%ld,%ld,%ld,%ld,%ld,%ld\n", cpu->dcache.hits, cpu->dcache.misses, cpu->dcache.coherence_misses,
+          cpu->dcache.upgrades, cpu->dcache.interventions, cpu->dcache.writebacks);
+}
+
+int
+main(int argc, char const* argv[])
+{
+  const char** inputs = calloc(argc, sizeof(*inputs));
+  if (!inputs) {
+    fprintf(stderr, "APEX_Error : Out of memory\n");
+    exit(1);
+  }
+  int num_inputs = 0;
+  const char* cycles = NULL;
+  const char* policy_name = NULL;
+  const char* width = NULL;
+  const char* bpred_spec = NULL;
+  const char* icache_spec = NULL;
+  const char* dcache_spec = DEFAULT_DCACHE;
+  const char* ooo_spec = NULL;
+  const char* mem_range = NULL;
+  const char* cache_dir = NULL;
+  int num_cores = 0;
+  int quantum = DEFAULT_QUANTUM;
+  int id_register = -1;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "cores=", 6) == 0) {
+      num_cores = strtol(argv[i] + 6, NULL, 0);
+      if (num_cores < 1 || num_cores > MAX_CORES) {
+        fprintf(stderr, "APEX_Error : Invalid number of cores %s, at most %d\n", argv[i] + 6, MAX_CORES);
+        exit(1);
+      }
+    } else if (strncmp(argv[i], "quantum=", 8) == 0) {
+      quantum = strtol(argv[i] + 8, NULL, 0);
+      if (quantum < 1) {
+        fprintf(stderr, "APEX_Error : Invalid quantum %s\n", argv[i] + 8);
+        exit(1);
+      }
+    } else if (strncmp(argv[i], "id=", 3) == 0) {
+      id_register = parse_register(argv[i] + 3);
+      if (id_register < 0) {
+        fprintf(stderr, "APEX_Error : Invalid core number register %s\n", argv[i] + 3);
+        exit(1);
+      }
+    } else if (strncmp(argv[i], "policy=", 7) == 0) {
+      policy_name = argv[i] + 7;
+    } else if (strncmp(argv[i], "width=", 6) == 0) {
+      width = argv[i] + 6;
+    } else if (strncmp(argv[i], "bpred=", 6) == 0) {
+      bpred_spec = argv[i] + 6;
+    } else if (strncmp(argv[i], "icache=", 7) == 0) {
+      icache_spec = argv[i] + 7;
+    } else if (strncmp(argv[i], "dcache=", 7) == 0) {
+      dcache_spec = argv[i] + 7;
+    } else if (strncmp(argv[i], "ooo=", 4) == 0) {
+      ooo_spec = argv[i] + 4;
+    } else if (strncmp(argv[i], "mem=", 4) == 0) {
+      mem_range = argv[i] + 4;
+    } else if (strncmp(argv[i], "cache=", 6) == 0) {
+      cache_dir = argv[i] + 6;
+    } else if (strncmp(argv[i], "unit=", 5) == 0) {
+      /* Applied once the cores exist */
+    } else if (!cycles) {
+      cycles = argv[i];
+    } else {
+      inputs[num_inputs++] = argv[i];
+    }
+  }
+  if (!num_inputs) {
+    fprintf(stderr, "APEX_Help : Usage %s <cycles> <input_file>... [cores=<n>] [quantum=<n>] [id=<register>] [mem=<address>:<count>] [policy=<name>] [width=<n>] [unit=<spec>]... [bpred=<spec>] [icache=<spec>] [dcache=<spec>] [ooo=<spec>] [cache=<dir>]\n", argv[0]);
+    fprintf(stderr, "APEX_Help : Simulates one core per input file, or cores= cores taking the\n"
+                    "            files in turn, each on a host thread. The cores share the\n"
+                    "            data memory and keep their L1 data caches coherent by\n"
+                    "            MESI. quantum= is how many cycles the cores run between\n"
+                    "            barriers, %d by default. id= starts every core with its\n"
+                    "            core number in that register, e.g. id=R15. dcache= must be\n"
+                    "            write-back, %s by default. mem= and the other options\n"
+                    "            are those of apex_sim, applied to every core.\n", DEFAULT_QUANTUM, DEFAULT_DCACHE);
+    exit(1);
+  }
+  if (!num_cores) {
+    num_cores = num_inputs;
+  }
+  if (num_cores > MAX_CORES) {
+    fprintf(stderr, "APEX_Error : At most %d cores\n", MAX_CORES);
+    exit(1);
+  }
+  int no_of_cycles = strtol(cycles, NULL, 0);
+  uint32_t mem_address = 0;
+  uint32_t mem_count = 0;
+  if (mem_range) {
+    char* end;
+    mem_address = strtoul(mem_range, &end, 0);
+    if (*end == ':') {
+      mem_count = strtoul(end + 1, &end, 0);
+    }
+    if (*end || mem_count == 0) {
+      fprintf(stderr, "APEX_Error : Invalid data memory range %s\n", mem_range);
+      exit(1);
+    }
+  }
+
+  /* Every distinct input file is parsed once */
+  Program* programs = calloc(num_inputs, sizeof(*programs));
+  int num_programs = 0;
+  int* program_of = calloc(num_inputs, sizeof(*program_of));
+  APEX_SharedMemory* shared = APEX_shared_memory_create();
+  struct APEX_Coherence* coherence = APEX_coherence_create();
+  Core* cores = calloc(num_cores, sizeof(*cores));
+  pthread_t* threads = calloc(num_cores, sizeof(*threads));
+  if (!programs || !program_of || !shared || !coherence || !cores || !threads) {
+    fprintf(stderr, "APEX_Error : Out of memory\n");
+    exit(1);
+  }
+  for (int i = 0; i < num_inputs; ++i) {
+    int p = 0;
+    while (p < num_programs && strcmp(programs[p].filename, inputs[i]) != 0) {
+      ++p;
+    }
+    if (p == num_programs) {
+      programs[p].filename = inputs[i];
+      programs[p].code_memory = APEX_load_program(inputs[i], cache_dir, &programs[p].code_memory_size);
+      if (!programs[p].code_memory) {
+        fprintf(stderr, "APEX_Error : Unable to load %s\n", inputs[i]);
+        exit(1);
+      }
+      num_programs++;
+    }
+    program_of[i] = p;
+  }
+
+  System system = { 0 };
+  system.no_of_cycles = no_of_cycles;
+  system.quantum = quantum;
+  system.num_cores = num_cores;
+  system.running = num_cores;
+  for (int n = 0; n < num_cores; ++n) {
+    Core* core = &cores[n];
+    core->system = &system;
+    core->program = program_of[n % num_inputs];
+    APEX_CPU* cpu = APEX_cpu_create(programs[core->program].code_memory, programs[core->program].code_memory_size);
+    if (!cpu) {
+      fprintf(stderr, "APEX_Error : Unable to initialize core %d\n", n);
+      exit(1);
+    }
+    core->cpu = cpu;
+    cpu->enable_debug_messages = 0;
+    if (policy_name && APEX_cpu_set_hazard_policy(cpu, APEX_hazard_policy_from_name(policy_name)) != 0) {
+      fprintf(stderr, "APEX_Error : Unknown hazard policy %s\n", policy_name);
+      exit(1);
+    }
+    if (width && APEX_cpu_set_width(cpu, strtol(width, NULL, 0)) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid width %s\n", width);
+      exit(1);
+    }
+    for (int i = 1; i < argc; ++i) {
+      if (strncmp(argv[i], "unit=", 5) == 0 && APEX_set_unit(cpu->units, argv[i] + 5) != 0) {
+        fprintf(stderr, "APEX_Error : Invalid functional unit %s\n", argv[i] + 5);
+        exit(1);
+      }
+    }
+    if (bpred_spec && APEX_bpred_configure(&cpu->bpred, bpred_spec) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid branch predictor %s\n", bpred_spec);
+      exit(1);
+    }
+    if (icache_spec && APEX_cache_configure(&cpu->icache, icache_spec) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid instruction cache %s\n", icache_spec);
+      exit(1);
+    }
+    if (APEX_cache_configure(&cpu->dcache, dcache_spec) != 0 || !cpu->dcache.write_back) {
+      fprintf(stderr, "APEX_Error : Invalid data cache %s, MESI needs a write-back one\n", dcache_spec);
+      exit(1);
+    }
+    if (ooo_spec && APEX_ooo_configure(cpu, ooo_spec) != 0) {
+      fprintf(stderr, "APEX_Error : Invalid out-of-order engine %s\n", ooo_spec);
+      exit(1);
+    }
+    cpu->dcache.coherence = coherence;
+    cpu->dcache.core = n;
+    cpu->data_memory.shared = shared;
+    if (id_register >= 0) {
+      cpu->regs[id_register] = n;
+    }
+  }
+
+  if (pthread_barrier_init(&system.barrier, NULL, num_cores) != 0) {
+    fprintf(stderr, "APEX_Error : Unable to create the barrier of %d cores\n", num_cores);
+    exit(1);
+  }
+  for (int n = 0; n < num_cores; ++n) {
+    if (pthread_create(&threads[n], NULL, core_main, &cores[n]) != 0) {
+      fprintf(stderr, "APEX_Error : Unable to start the thread of core %d\n", n);
+      exit(1);
+    }
+  }
+  for (int n = 0; n < num_cores; ++n) {
+    pthread_join(threads[n], NULL);
+  }
+  pthread_barrier_destroy(&system.barrier);
+
+  printf("core,input_file,policy,cycles,retired");
+  for (int i = 0; i < 16; ++i) {
+    printf(",R%d", i);
+  }
+  printf(",CC,dcache_hits,dcache_misses,coherence_misses,upgrades,interventions,writebacks\n");
+  for (int n = 0; n < num_cores; ++n) {
+    print_core(stdout, programs, &cores[n], n);
+  }
+  /* Any core shows the memory of all of them */
+  print_data_memory(cores[0].cpu, mem_address, mem_count);
+
+  for (int n = 0; n < num_cores; ++n) {
+    APEX_cpu_stop(cores[n].cpu);
+  }
+  for (int p = 0; p < num_programs; ++p) {
+    free(programs[p].code_memory);
+  }
+  APEX_shared_memory_free(shared);
+  APEX_coherence_free(coherence);
+  free(programs);
+  free(program_of);
+  free(cores);
+  free(threads);
+  free(inputs);
+  return 0;
+}
@@ -0,0 +1,626 @@
+/*
+ *  ooo.c
+ *  Contains the out-of-order back end
+ *
+ *  The engine is configured from
+ *
+ *    <rob>[:<iq>[:<prf>]]
+ *
+ *  the number of ROB entries (at most 256), issue queue entries (half the
+ *  ROB by default, at most 64) and physical registers (17 plus two per
+ *  ROB entry by default, at most 544, at least 19). It replaces EX1 to WB
+ *  of the pipeline; fetch, with its predictor and I-cache, still hands
+ *  groups of width instructions to decode, which becomes the rename
+ *  stage. Every cycle, in this order:
+ *
+ *    complete - issued instructions whose result is due become done, and
+ *               a branch fetch did not follow squashes everything younger
+ *    commit   - up to width done instructions leave the ROB in program
+ *               order, writing the architectural registers and, for a
+ *               store, the data memory
+ *    issue    - up to width waiting instructions whose operands are
+ *               available go to a free functional unit, oldest first:
+ *               width ALUs, the multiplier and the memory port, timed by
+ *               the unit= settings and the D-cache
+ *    rename   - the decode group enters the ROB and the issue queue in
+ *               program order while there is room in both and a physical
+ *               register for each result
+ *
+ *  A load waits until every older store in the ROB has its address, then
+ *  takes the value of the youngest older store to the same address, or
+ *  reads the data memory. Stores only write it when they commit, so a
+ *  squash never has to undo one. The hazard policy does not apply, every
+ *  result wakes up its consumers in the cycle it is available.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* Stage contents are wanted, either printed or in a binary trace */
+static inline int
+tracing(const APEX_CPU* cpu)
+{
+  return cpu->enable_debug_messages || cpu->trace;
+}
+
+/* Records the instruction under stage s in the binary trace if one is open, else prints it */
+static void
+report(APEX_CPU* cpu, int s, CPU_Stage* stage, int is_active)
+{
+  if (cpu->trace) {
+    APEX_trace_stage(cpu->trace, s, stage, is_active);
+  } else {
+    print_stage_content(stage_names[s], stage, is_active);
+  }
+}
+
+/* Index of the entry n places after the ROB head */
+static inline int
+rob_index(const APEX_OutOfOrder* ooo, int n)
+{
+  return (ooo->rob_head + n) & (APEX_OOO_MAX_ROB - 1);
+}
+
+/* Places entry index is after the ROB head, i.e. its age rank */
+static inline int
+rob_position(const APEX_OutOfOrder* ooo, int index)
+{
+  return (index - ooo->rob_head) & (APEX_OOO_MAX_ROB - 1);
+}
+
+/* Returns 1 if pc is the address of an instruction, as EX2 checks */
+static inline int
+valid_target(const APEX_CPU* cpu, int pc)
+{
+  return pc % 4 == 0 && pc >= 4000 && get_code_index(pc) < cpu->code_memory_size;
+}
+
+/*
+ * Sets up an empty engine of the sizes in spec, see the top of this
+ * file. The engine has to be chosen before the pipeline runs. Returns
+ * -1, leaving cpu untouched, if spec is not valid or the cpu has run.
+ */
+int
+APEX_ooo_configure(APEX_CPU* cpu, const char* spec)
+{
+  char* end;
+  long rob = strtol(spec, &end, 0);
+  if (end == spec) {
+    return -1;
+  }
+  long iq = rob / 2 > 0 ? rob / 2 : 1;
+  long prf = 17 + 2 * rob;
+  if (iq > APEX_OOO_MAX_IQ) {
+    iq = APEX_OOO_MAX_IQ;
+  }
+  if (prf > APEX_OOO_MAX_PRF) {
+    prf = APEX_OOO_MAX_PRF;
+  }
+  if (*end == ':') {
+    const char* p = end + 1;
+    iq = strtol(p, &end, 0);
+    if (end == p) {
+      return -1;
+    }
+  }
+  if (*end == ':') {
+    const char* p = end + 1;
+    prf = strtol(p, &end, 0);
+    if (end == p) {
+      return -1;
+    }
+  }
+  /* Rename needs two free registers for an instruction that writes rd and CC */
+  if (*end || rob < 1 || rob > APEX_OOO_MAX_ROB || iq < 1 || iq > APEX_OOO_MAX_IQ ||
+      prf < 17 + 2 || prf > APEX_OOO_MAX_PRF) {
+    return -1;
+  }
+  if (cpu->clock != 0) {
+    return -1;
+  }
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  memset(ooo, 0, sizeof(*ooo));
+  ooo->rob_size = rob;
+  ooo->iq_size = iq;
+  ooo->prf_size = prf;
+  return 0;
+}
+
+/* Returns 1 if p is a physical register of ooo, or -1 for none where none is allowed */
+static int
+valid_register(const APEX_OutOfOrder* ooo, int p, int allow_none)
+{
+  return (allow_none && p == -1) || (p >= 0 && p < ooo->prf_size);
+}
+
+/*
+ * Returns 1 if the engine of cpu, restored from outside this run, has
+ * sizes APEX_ooo_configure could have set up and every ROB, issue queue,
+ * rename and free list entry in use points inside them.
+ */
+int
+APEX_ooo_valid(const APEX_CPU* cpu)
+{
+  const APEX_OutOfOrder* ooo = &cpu->ooo;
+  if (ooo->rob_size == 0) {
+    return 1;
+  }
+  if (ooo->rob_size < 1 || ooo->rob_size > APEX_OOO_MAX_ROB || ooo->iq_size < 1 || ooo->iq_size > APEX_OOO_MAX_IQ ||
+      ooo->prf_size < 17 + 2 || ooo->prf_size > APEX_OOO_MAX_PRF ||
+      ooo->rob_head < 0 || ooo->rob_head >= APEX_OOO_MAX_ROB || ooo->rob_count < 0 || ooo->rob_count > ooo->rob_size ||
+      ooo->iq_count < 0 || ooo->iq_count > ooo->iq_size || ooo->free_count < 0 || ooo->free_count > ooo->prf_size) {
+    return 0;
+  }
+  for (int r = 0; r < 17; ++r) {
+    if (!valid_register(ooo, ooo->rename[r], 0)) {
+      return 0;
+    }
+  }
+  for (int i = 0; i < ooo->free_count; ++i) {
+    if (!valid_register(ooo, ooo->free_list[i], 0)) {
+      return 0;
+    }
+  }
+  for (int i = 0; i < ooo->iq_count; ++i) {
+    if (ooo->iq[i] < 0 || ooo->iq[i] >= APEX_OOO_MAX_ROB || rob_position(ooo, ooo->iq[i]) >= ooo->rob_count) {
+      return 0;
+    }
+  }
+  /* Every result in flight gives one register back to the free list */
+  int results = 0;
+  for (int n = 0; n < ooo->rob_count; ++n) {
+    const APEX_RobEntry* entry = &ooo->rob[rob_index(ooo, n)];
+    if (!APEX_stage_valid(&entry->ins) || entry->state > ROB_DONE ||
+        !valid_register(ooo, entry->src[0], 1) || !valid_register(ooo, entry->src[1], 1) ||
+        !valid_register(ooo, entry->src[2], 1) || !valid_register(ooo, entry->dest, 1) ||
+        !valid_register(ooo, entry->dest_cc, 1) ||
+        !valid_register(ooo, entry->prev_dest, entry->dest < 0) ||
+        !valid_register(ooo, entry->prev_cc, entry->dest_cc < 0) ||
+        (entry->dest >= 0 && !(entry->ins.op_flags & OPF_RD)) ||
+        (entry->state == ROB_DONE && entry->taken && !valid_target(cpu, entry->target))) {
+      return 0;
+    }
+    results += (entry->dest >= 0) + (entry->dest_cc >= 0);
+  }
+  return ooo->free_count + results <= ooo->prf_size;
+}
+
+/* Maps every architectural register onto a physical one holding its current value */
+static void
+reset_rename(APEX_CPU* cpu)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  for (int r = 0; r < 17; ++r) {
+    ooo->rename[r] = r;
+    ooo->prf[r] = cpu->regs[r];
+    ooo->prf_ready[r] = 0;
+  }
+  ooo->free_count = 0;
+  for (int p = ooo->prf_size - 1; p >= 17; --p) {
+    ooo->free_list[ooo->free_count++] = p;
+  }
+}
+
+/* Takes a free physical register for a result that is not computed yet */
+static int
+allocate(APEX_OutOfOrder* ooo)
+{
+  int p = ooo->free_list[--ooo->free_count];
+  ooo->prf_ready[p] = INT_MAX;
+  return p;
+}
+
+static inline void
+release(APEX_OutOfOrder* ooo, int p)
+{
+  ooo->free_list[ooo->free_count++] = p;
+}
+
+/*
+ * Squashes every ROB entry younger than the one at index, youngest
+ * first so that the rename table ends up as that instruction left it,
+ * and everything in fetch and decode. Fetch goes on from pc.
+ */
+static void
+squash_after(APEX_CPU* cpu, int index, int pc)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  int keep = rob_position(ooo, index) + 1;
+  while (ooo->rob_count > keep) {
+    APEX_RobEntry* entry = &ooo->rob[rob_index(ooo, --ooo->rob_count)];
+    if (entry->dest_cc >= 0) {
+      ooo->rename[CC] = entry->prev_cc;
+      release(ooo, entry->dest_cc);
+    }
+    if (entry->dest >= 0) {
+      ooo->rename[entry->ins.rd] = entry->prev_dest;
+      release(ooo, entry->dest);
+    }
+    cpu->stats.squashed++;
+  }
+  int waiting = 0;
+  for (int i = 0; i < ooo->iq_count; ++i) {
+    if (rob_position(ooo, ooo->iq[i]) < keep) {
+      ooo->iq[waiting++] = ooo->iq[i];
+    }
+  }
+  ooo->iq_count = waiting;
+
+  CPU_Stage* decode = cpu->stage[DRF];
+  if (decode->pc >= 4000 && decode->seq > cpu->stage_seq[DRF] && get_code_index(decode->pc) < cpu->code_memory_size) {
+    cpu->stats.squashed += decode->count ? decode->count : 1;
+  }
+  cpu->stage[DRF]->pc = cpu->stage[F]->pc = 0;
+  cpu->stage[DRF]->stalled = cpu->stage[F]->stalled = 0;
+  cpu->stage[F]->busy = 0;
+  /* A wrong-path JUMP may go anywhere; such a target never commits */
+  cpu->pc = valid_target(cpu, pc) ? pc : 4000 + cpu->code_memory_size * 4;
+}
+
+/*
+ * Marks the issued instructions whose result is due as done, oldest
+ * first. The first branch that resolves against the way fetch went
+ * squashes everything behind it.
+ */
+static void
+complete(APEX_CPU* cpu)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  for (int n = 0; n < ooo->rob_count; ++n) {
+    int index = rob_index(ooo, n);
+    APEX_RobEntry* entry = &ooo->rob[index];
+    if (entry->state != ROB_ISSUED || cpu->clock < entry->ready) {
+      continue;
+    }
+    entry->state = ROB_DONE;
+    if (entry->mispredicted) {
+      cpu->stats.branch_flushes++;
+      squash_after(cpu, index, entry->taken ? entry->target : entry->ins.pc + 4);
+      return;
+    }
+  }
+}
+
+/*
+ * Commits up to width done instructions from the ROB head. Returns 1
+ * once HALT has committed.
+ */
+static int
+commit(APEX_CPU* cpu)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  int committed = 0;
+  while (committed < cpu->width && ooo->rob_count && ooo->rob[ooo->rob_head].state == ROB_DONE) {
+    APEX_RobEntry* entry = &ooo->rob[ooo->rob_head];
+    CPU_Stage* stage = &entry->ins;
+    if (entry->dest >= 0) {
+      cpu->regs[stage->rd] = ooo->prf[entry->dest];
+      APEX_watch_register(cpu, stage->rd, stage->pc);
+      release(ooo, entry->prev_dest);
+    }
+    if (entry->dest_cc >= 0) {
+      cpu->regs[CC] = ooo->prf[entry->dest_cc];
+      APEX_watch_register(cpu, CC, stage->pc);
+      release(ooo, entry->prev_cc);
+    }
+    if (stage->op_flags & OPF_STORE) {
+      APEX_memory_write(&cpu->data_memory, stage->mem_address, stage->rs1_value);
+      APEX_watch_memory(cpu, stage->mem_address, stage->pc);
+    }
+    if (stage->op_flags & OPF_BRANCH) {
+      if (entry->taken) {
+        int ins_index = get_code_index(entry->target);
+        assert(entry->target % 4 == 0 && ins_index < cpu->code_memory_size && ins_index >= 0);
+      }
+      APEX_bpred_update(&cpu->bpred, stage->pc, stage->op, stage->bpred_counter, entry->taken, entry->target, entry->mispredicted);
+    }
+    if (tracing(cpu)) {
+      report(cpu, WB, stage, 1);
+    }
+    ooo->rob_head = rob_index(ooo, 1);
+    ooo->rob_count--;
+    committed++;
+    cpu->ins_completed++;
+    if (stage->op == OP_HALT) {
+      cpu->halted = 1;
+      return 1;
+    }
+  }
+  if (!committed && tracing(cpu)) {
+    report(cpu, WB, cpu->stage[WB], 0);
+  }
+  return 0;
+}
+
+/*
+ * Checks the older stores in the ROB for the load at index. Returns 0
+ * if one of them has no address yet. Otherwise returns 1, with *store
+ * the youngest one writing the address the load reads, NULL if none.
+ */
+static int
+order_load(APEX_OutOfOrder* ooo, int index, const APEX_RobEntry** store)
+{
+  *store = NULL;
+  for (int n = rob_position(ooo, index) - 1; n >= 0; --n) {
+    const APEX_RobEntry* older = &ooo->rob[rob_index(ooo, n)];
+    if (!(older->ins.op_flags & OPF_STORE)) {
+      continue;
+    }
+    if (older->state == ROB_WAITING) {
+      return 0;
+    }
+    if (older->ins.mem_address == ooo->rob[index].ins.mem_address) {
+      *store = older;
+      return 1;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Tries to start the waiting instruction at index in a functional unit.
+ * Returns 1 if it issued.
+ */
+static int
+issue_one(APEX_CPU* cpu, int index)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  APEX_RobEntry* entry = &ooo->rob[index];
+  CPU_Stage* stage = &entry->ins;
+  for (int i = 0; i < 3; ++i) {
+    if (entry->src[i] >= 0 && cpu->clock < ooo->prf_ready[entry->src[i]]) {
+      return 0;
+    }
+  }
+  int is_mul = stage->op == OP_MUL;
+  int alu = -1;
+  if (is_mul) {
+    if (cpu->clock < ooo->mul_free) {
+      return 0;
+    }
+  } else {
+    for (int i = 0; i < cpu->width && alu < 0; ++i) {
+      if (cpu->clock >= ooo->alu_free[i]) {
+        alu = i;
+      }
+    }
+    if (alu < 0) {
+      return 0;
+    }
+  }
+
+  /* Read the operands and compute, a memory access needs the address first */
+  int* values[3] = { &stage->rs1_value, &stage->rs2_value, &stage->rs3_value };
+  if (stage->op == OP_BZ || stage->op == OP_BNZ) {
+    values[0] = &stage->buffer;
+  }
+  for (int i = 0; i < 3; ++i) {
+    if (entry->src[i] >= 0) {
+      *values[i] = ooo->prf[entry->src[i]];
+    }
+  }
+  APEX_alu_compute(stage);
+  const APEX_Unit* alu_unit = &cpu->units[UNIT_ALU];
+  const APEX_Unit* mem_unit = &cpu->units[UNIT_MEM];
+  entry->ready = cpu->clock + cpu->units[is_mul ? UNIT_MUL : UNIT_ALU].latency;
+  if (stage->op_flags & (OPF_LOAD | OPF_STORE)) {
+    const APEX_RobEntry* store = NULL;
+    if ((stage->op_flags & OPF_LOAD) && !order_load(ooo, index, &store)) {
+      return 0;
+    }
+    if (store) {
+      /* Forwarded from the store, the memory port is not needed */
+      stage->buffer = store->ins.rs1_value;
+      entry->ready = cpu->clock + alu_unit->latency + mem_unit->latency;
+      ooo->load_forwards++;
+    } else {
+      if (cpu->clock < ooo->port_free) {
+        return 0;
+      }
+      int miss_cycles = cpu->dcache.sets ? APEX_cache_access(&cpu->dcache, stage->mem_address, (stage->op_flags & OPF_STORE) != 0) : 0;
+      if (stage->op_flags & OPF_LOAD) {
+        stage->buffer = APEX_memory_read(&cpu->data_memory, stage->mem_address);
+      }
+      ooo->port_free = cpu->clock + mem_unit->interval + miss_cycles;
+      if (stage->op_flags & OPF_LOAD) {
+        entry->ready = cpu->clock + alu_unit->latency + mem_unit->latency + miss_cycles;
+      }
+    }
+  }
+  if (is_mul) {
+    ooo->mul_free = cpu->clock + cpu->units[UNIT_MUL].interval;
+  } else {
+    ooo->alu_free[alu] = cpu->clock + alu_unit->interval;
+  }
+
+  if (stage->op_flags & OPF_BRANCH) {
+    /* buffer holds the CC flag, or the JUMP target */
+    entry->taken = stage->op == OP_JUMP || (stage->op == OP_BZ && stage->buffer == 1) || (stage->op == OP_BNZ && stage->buffer == 0);
+    entry->target = stage->op == OP_JUMP ? stage->buffer : stage->pc + stage->imm;
+    entry->mispredicted = (entry->taken ? entry->target : stage->pc + 4) != stage->predicted_pc;
+  }
+  if (entry->dest >= 0) {
+    ooo->prf[entry->dest] = stage->buffer;
+    ooo->prf_ready[entry->dest] = entry->ready;
+  }
+  if (entry->dest_cc >= 0) {
+    ooo->prf[entry->dest_cc] = stage->buffer == 0;
+    ooo->prf_ready[entry->dest_cc] = entry->ready;
+  }
+  entry->state = ROB_ISSUED;
+  if (tracing(cpu)) {
+    report(cpu, EX1, stage, 1);
+  }
+  return 1;
+}
+
+/* Selects up to width ready instructions from the issue queue, oldest first */
+static void
+issue(APEX_CPU* cpu)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  int issued = 0;
+  int waiting = 0;
+  for (int i = 0; i < ooo->iq_count; ++i) {
+    if (issued < cpu->width && issue_one(cpu, ooo->iq[i])) {
+      issued++;
+    } else {
+      ooo->iq[waiting++] = ooo->iq[i];
+    }
+  }
+  ooo->iq_count = waiting;
+  if (issued) {
+    cpu->stats.issued[issued]++;
+  } else if (tracing(cpu)) {
+    report(cpu, EX1, cpu->stage[EX1], 0);
+  }
+}
+
+/*
+ * Renames the instructions of the decode group in program order into
+ * the ROB and the issue queue. What does not fit waits in decode, and
+ * holds fetch, until the next cycle.
+ */
+static void
+rename_group(APEX_CPU* cpu)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  CPU_Stage* group = cpu->stage[DRF];
+  int count = group->count ? group->count : 1;
+  int renamed = 0;
+  group->stalled = 0;
+  if (group->pc < 4000 || group->seq <= cpu->stage_seq[DRF]) {
+    if (tracing(cpu)) {
+      report(cpu, DRF, group, 0);
+    }
+    return;
+  }
+  int halt = 0;
+  while (renamed < count && !halt) {
+    CPU_Stage* stage = &group[renamed];
+    /* The end of the program only drains the ROB */
+    if (get_code_index(stage->pc) >= cpu->code_memory_size) {
+      break;
+    }
+    int results = ((stage->op_flags & OPF_RD) != 0) + ((stage->op_flags & OPF_SETS_CC) != 0);
+    if (ooo->rob_count == ooo->rob_size) {
+      ooo->stall_rob++;
+      break;
+    }
+    if (stage->op != OP_HALT && ooo->iq_count == ooo->iq_size) {
+      ooo->stall_iq++;
+      break;
+    }
+    if (ooo->free_count < results) {
+      ooo->stall_prf++;
+      break;
+    }
+
+    int index = rob_index(ooo, ooo->rob_count++);
+    APEX_RobEntry* entry = &ooo->rob[index];
+    memset(entry, 0, sizeof(*entry));
+    entry->ins = *stage;
+    entry->src[0] = entry->src[1] = entry->src[2] = -1;
+    if (stage->op == OP_BZ || stage->op == OP_BNZ) {
+      entry->src[0] = ooo->rename[CC];
+    } else {
+      entry->src[0] = (stage->op_flags & OPF_RS1) ? ooo->rename[stage->rs1] : -1;
+      entry->src[1] = (stage->op_flags & OPF_RS2) ? ooo->rename[stage->rs2] : -1;
+      entry->src[2] = (stage->op_flags & OPF_RS3) ? ooo->rename[stage->rs3] : -1;
+    }
+    entry->dest = entry->dest_cc = entry->prev_dest = entry->prev_cc = -1;
+    if (stage->op_flags & OPF_RD) {
+      entry->prev_dest = ooo->rename[stage->rd];
+      entry->dest = ooo->rename[stage->rd] = allocate(ooo);
+    }
+    if (stage->op_flags & OPF_SETS_CC) {
+      entry->prev_cc = ooo->rename[CC];
+      entry->dest_cc = ooo->rename[CC] = allocate(ooo);
+    }
+    if (stage->op == OP_HALT) {
+      /* Nothing to execute; fetch stops behind it unless it is squashed */
+      entry->state = ROB_DONE;
+      halt = 1;
+    } else {
+      entry->state = ROB_WAITING;
+      ooo->iq[ooo->iq_count++] = index;
+    }
+    renamed++;
+  }
+
+  if (tracing(cpu) && get_code_index(group->pc) >= cpu->code_memory_size) {
+    report(cpu, DRF, group, 0);
+  } else if (tracing(cpu)) {
+    for (int lane = 0; lane < count; ++lane) {
+      report(cpu, DRF, &group[lane], 1);
+    }
+  }
+  if (renamed) {
+    cpu->stage_seq[DRF] = group[renamed - 1].seq;
+  }
+  if (halt) {
+    cpu->pc = 4000 + cpu->code_memory_size * 4;
+    group->pc = cpu->stage[F]->pc = 0;
+    cpu->stage[F]->busy = 0;
+    cpu->stage[F]->stalled = 0;
+  } else if (renamed < count) {
+    memmove(group, group + renamed, (count - renamed) * sizeof(CPU_Stage));
+    group->count = count - renamed;
+    group->stalled = 1;
+    cpu->stage[F]->stalled = 1;
+  } else {
+    cpu->stage[F]->stalled = 0;
+  }
+}
+
+/*
+ *  Out-of-order simulation loop, run by APEX_cpu_simulate once the
+ *  engine is configured.
+ *
+ *  Runs until HALT commits, the ROB drains at the end of the program or
+ *  the clock passes no_of_cycles. With the stage contents wanted, every
+ *  cycle lists the instructions committed under WB, those issued under
+ *  EX1, then decode and fetch.
+ */
+int
+APEX_ooo_simulate(APEX_CPU* cpu, int no_of_cycles)
+{
+  APEX_OutOfOrder* ooo = &cpu->ooo;
+  /* Whatever committed before, by the functional interpreter included, is in cpu->regs */
+  if (!ooo->rob_count) {
+    reset_rename(cpu);
+  }
+  while (!cpu->halted && cpu->clock <= no_of_cycles) {
+    if (cpu->trace) {
+      APEX_trace_cycle(cpu->trace, cpu->clock+1);
+    } else if (cpu->enable_debug_messages) {
+      printf("--------------------------------\n");
+      printf("Clock Cycle #: %d\n", cpu->clock+1);
+      printf("--------------------------------\n");
+    }
+
+    cpu->stats.cycles++;
+    complete(cpu);
+    if (commit(cpu)) {
+      break;
+    }
+    const CPU_Stage* decode = cpu->stage[DRF];
+    if (!ooo->rob_count && decode->pc >= 4000 && decode->seq > cpu->stage_seq[DRF] &&
+        get_code_index(decode->pc) >= cpu->code_memory_size) {
+      /* Past the end of the program with nothing left in flight */
+      break;
+    }
+    issue(cpu);
+    rename_group(cpu);
+    fetch(cpu);
+
+    ooo->rob_occupancy[ooo->rob_count]++;
+    ooo->iq_occupancy[ooo->iq_count]++;
+    ooo->prf_occupancy[ooo->prf_size - ooo->free_count]++;
+    cpu->clock++;
+  }
+  return 0;
+}
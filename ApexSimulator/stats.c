@@ -0,0 +1,211 @@
+/*
+ *  stats.c
+ *  Contains the export of the microarchitectural statistics counters
+ *
+ *  APEX_stats_save writes cpu->stats as CSV (one header row and one value
+ *  row) when the path ends in ".csv", and as JSON otherwise. A path of
+ *  "-" writes JSON to stdout.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+
+/* Retired per pipeline cycle, instructions fast-forwarded functionally are not counted */
+static double
+ipc(const APEX_CPU* cpu)
+{
+  return cpu->stats.cycles ? (double) cpu->ins_completed / cpu->stats.cycles : 0.0;
+}
+
+/* Instructions decode sent to EX1, out of width issue slots per cycle */
+static long
+issue_slots_used(const APEX_CPU* cpu)
+{
+  long used = 0;
+  for (int n = 1; n <= APEX_MAX_WIDTH; ++n) {
+    used += n * cpu->stats.issued[n];
+  }
+  return used;
+}
+
+static double
+issue_utilization(const APEX_CPU* cpu)
+{
+  return cpu->stats.cycles ? (double) issue_slots_used(cpu) / ((double) cpu->stats.cycles * cpu->width) : 0.0;
+}
+
+/* Cycles fetch would have lost to flushes without the predictor: every
+ * taken branch flushes then, and each flush costs the stages from F to EX2 */
+static long
+cycles_saved(const APEX_BranchPredictor* bpred)
+{
+  return (bpred->taken - bpred->mispredicted) * (EX2 - F);
+}
+
+/* Member name of the object with the geometry and counters of cache, without the separator after it */
+static void
+write_cache_json(const APEX_Cache* cache, const char* name, FILE* fp)
+{
+  if (!cache->sets) {
+    fprintf(fp, "  \"%s\": null", name);
+    return;
+  }
+  fprintf(fp, "  \"%s\": { \"size\": %d, \"ways\": %d, \"line\": %d, \"miss_penalty\": %d, "
+              "\"replacement\": \"%s\", \"write_policy\": \"%s\",\n",
+          name, cache->sets * cache->ways * cache->line_words, cache->ways, cache->line_words,
+          cache->miss_penalty, replacement_names[cache->replacement], cache->write_back ? "wb" : "wt");
+  long accesses = cache->hits + cache->misses;
+  fprintf(fp, "    \"hits\": %ld, \"misses\": %ld, \"hit_rate\": %.4f, \"evictions\": %ld, \"writebacks\": %ld }",
+          cache->hits, cache->misses, accesses ? (double) cache->hits / accesses : 0.0, cache->evictions, cache->writebacks);
+}
+
+/* Mean of a histogram of cycles with n entries in use, for n up to size */
+static double
+mean_occupancy(const long* cycles, int size)
+{
+  long total = 0;
+  double sum = 0.0;
+  for (int n = 0; n <= size; ++n) {
+    total += cycles[n];
+    sum += (double) n * cycles[n];
+  }
+  return total ? sum / total : 0.0;
+}
+
+/* Member of the out-of-order engine object: mean and cycles with n entries in use, for n up to size */
+static void
+write_occupancy_json(const long* cycles, int size, const char* name, FILE* fp)
+{
+  fprintf(fp, "    \"%s\": { \"size\": %d, \"mean\": %.4f, \"cycles\": [", name, size, mean_occupancy(cycles, size));
+  for (int n = 0; n <= size; ++n) {
+    fprintf(fp, "%s %ld", n ? "," : "", cycles[n]);
+  }
+  fprintf(fp, " ] }");
+}
+
+/* Member name of the object with the engine sizes and counters, without the separator after it */
+static void
+write_ooo_json(const APEX_OutOfOrder* ooo, FILE* fp)
+{
+  if (!ooo->rob_size) {
+    fprintf(fp, "  \"ooo\": null");
+    return;
+  }
+  fprintf(fp, "  \"ooo\": { \"rename_stalls\": { \"rob\": %ld, \"iq\": %ld, \"prf\": %ld }, \"load_forwards\": %ld,\n",
+          ooo->stall_rob, ooo->stall_iq, ooo->stall_prf, ooo->load_forwards);
+  write_occupancy_json(ooo->rob_occupancy, ooo->rob_size, "rob", fp);
+  fprintf(fp, ",\n");
+  write_occupancy_json(ooo->iq_occupancy, ooo->iq_size, "iq", fp);
+  fprintf(fp, ",\n");
+  write_occupancy_json(ooo->prf_occupancy, ooo->prf_size, "prf", fp);
+  fprintf(fp, " }");
+}
+
+static void
+write_json(const APEX_CPU* cpu, FILE* fp)
+{
+  const APEX_Stats* stats = &cpu->stats;
+  fprintf(fp, "{\n");
+  fprintf(fp, "  \"cycles\": %ld,\n", stats->cycles);
+  fprintf(fp, "  \"retired\": %d,\n", cpu->ins_completed);
+  fprintf(fp, "  \"fast_forwarded\": %ld,\n", cpu->ins_fast_forwarded);
+  fprintf(fp, "  \"hazard_policy\": \"%s\",\n", hazard_policy_names[cpu->hazard_policy]);
+  fprintf(fp, "  \"ipc\": %.4f,\n", ipc(cpu));
+  fprintf(fp, "  \"issue\": { \"width\": %d, \"slots_used\": %ld, \"utilization\": %.4f, \"cycles_issuing\": [",
+          cpu->width, issue_slots_used(cpu), issue_utilization(cpu));
+  /* Cycles in which decode sent none, one, ... width instructions on */
+  long idle = stats->cycles;
+  for (int n = 1; n <= cpu->width; ++n) {
+    idle -= stats->issued[n];
+  }
+  fprintf(fp, " %ld", idle);
+  for (int n = 1; n <= cpu->width; ++n) {
+    fprintf(fp, ", %ld", stats->issued[n]);
+  }
+  fprintf(fp, " ] },\n");
+  fprintf(fp, "  \"units\": {");
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    fprintf(fp, "%s \"%s\": { \"latency\": %d, \"interval\": %d }", unit ? "," : "",
+            unit_names[unit], cpu->units[unit].latency, cpu->units[unit].interval);
+  }
+  fprintf(fp, " },\n");
+  fprintf(fp, "  \"decode_stalls\": { \"raw\": %ld, \"cc\": %ld, \"load_use\": %ld, \"structural\": %ld },\n",
+          stats->stall_raw, stats->stall_cc, stats->stall_load_use, stats->stall_structural);
+  fprintf(fp, "  \"forwarded\": { \"EX1\": %ld, \"EX2\": %ld, \"MEM1\": %ld, \"MEM2\": %ld },\n",
+          stats->forwarded[EX1], stats->forwarded[EX2], stats->forwarded[MEM1], stats->forwarded[MEM2]);
+  fprintf(fp, "  \"branch_flushes\": %ld,\n", stats->branch_flushes);
+  fprintf(fp, "  \"squashed\": %ld,\n", stats->squashed);
+  fprintf(fp, "  \"halt_drain_cycles\": %ld,\n", stats->halt_drain_cycles);
+  fprintf(fp, "  \"fetch_stalls\": %ld,\n", stats->stall_fetch);
+  const APEX_BranchPredictor* bpred = &cpu->bpred;
+  fprintf(fp, "  \"branch_prediction\": { \"predictor\": \"%s\", \"table_bits\": %d, \"history_bits\": %d, \"btb_entries\": %d,\n",
+          bpred_names[bpred->kind], bpred->table_bits, bpred->history_bits, bpred->btb_entries);
+  fprintf(fp, "    \"branches\": %ld, \"taken\": %ld, \"mispredicted\": %ld, \"btb_misses\": %ld, \"accuracy\": %.4f, \"cycles_saved\": %ld },\n",
+          bpred->branches, bpred->taken, bpred->mispredicted, bpred->btb_misses,
+          bpred->branches ? 1.0 - (double) bpred->mispredicted / bpred->branches : 0.0, cycles_saved(bpred));
+  write_cache_json(&cpu->icache, "icache", fp);
+  fprintf(fp, ",\n");
+  write_cache_json(&cpu->dcache, "dcache", fp);
+  fprintf(fp, ",\n");
+  write_ooo_json(&cpu->ooo, fp);
+  fprintf(fp, "\n}\n");
+}
+
+static void
+write_csv(const APEX_CPU* cpu, FILE* fp)
+{
+  const APEX_Stats* stats = &cpu->stats;
+  fprintf(fp, "hazard_policy,cycles,retired,fast_forwarded,ipc,stall_raw,stall_cc,stall_load_use,stall_structural,"
+              "forwarded_ex1,forwarded_ex2,forwarded_mem1,forwarded_mem2,branch_flushes,squashed,halt_drain_cycles,"
+              "bpred,branches,taken,mispredicted,cycles_saved,stall_fetch,icache_hits,icache_misses,icache_evictions,"
+              "dcache_hits,dcache_misses,dcache_evictions,dcache_writebacks,width,issue_slots_used,issue_utilization,"
+              "rob_size,iq_size,prf_size,rob_mean,iq_mean,prf_mean,rename_stall_rob,rename_stall_iq,rename_stall_prf,"
+              "load_forwards");
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    fprintf(fp, ",%s_latency,%s_interval", unit_names[unit], unit_names[unit]);
+  }
+  fprintf(fp, "\n%s,%ld,%d,%ld,%.4f,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%s,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%d,%ld,%.4f,%d,%d,%d,%.4f,%.4f,%.4f,%ld,%ld,%ld,%ld",
+          hazard_policy_names[cpu->hazard_policy],
+          stats->cycles, cpu->ins_completed, cpu->ins_fast_forwarded, ipc(cpu),
+          stats->stall_raw, stats->stall_cc, stats->stall_load_use, stats->stall_structural,
+          stats->forwarded[EX1], stats->forwarded[EX2], stats->forwarded[MEM1], stats->forwarded[MEM2],
+          stats->branch_flushes, stats->squashed, stats->halt_drain_cycles,
+          bpred_names[cpu->bpred.kind], cpu->bpred.branches, cpu->bpred.taken, cpu->bpred.mispredicted, cycles_saved(&cpu->bpred),
+          stats->stall_fetch, cpu->icache.hits, cpu->icache.misses, cpu->icache.evictions,
+          cpu->dcache.hits, cpu->dcache.misses, cpu->dcache.evictions, cpu->dcache.writebacks,
+          cpu->width, issue_slots_used(cpu), issue_utilization(cpu),
+          cpu->ooo.rob_size, cpu->ooo.iq_size, cpu->ooo.prf_size,
+          mean_occupancy(cpu->ooo.rob_occupancy, cpu->ooo.rob_size),
+          mean_occupancy(cpu->ooo.iq_occupancy, cpu->ooo.iq_size),
+          mean_occupancy(cpu->ooo.prf_occupancy, cpu->ooo.prf_size),
+          cpu->ooo.stall_rob, cpu->ooo.stall_iq, cpu->ooo.stall_prf, cpu->ooo.load_forwards);
+  for (int unit = 0; unit < NUM_UNITS; ++unit) {
+    fprintf(fp, ",%d,%d", cpu->units[unit].latency, cpu->units[unit].interval);
+  }
+  fprintf(fp, "\n");
+}
+
+/*
+ * Writes the statistics counters of cpu to path.
+ * Returns 0 on success, -1 on failure.
+ */
+int
+APEX_stats_save(const APEX_CPU* cpu, const char* path)
+{
+  if (strcmp(path, "-") == 0) {
+    write_json(cpu, stdout);
+    return 0;
+  }
+  FILE* fp = fopen(path, "w");
+  if (!fp) {
+    return -1;
+  }
+  size_t len = strlen(path);
+  if (len >= 4 && strcmp(path + len - 4, ".csv") == 0) {
+    write_csv(cpu, fp);
+  } else {
+    write_json(cpu, fp);
+  }
+  return fclose(fp) == 0 ? 0 : -1;
+}
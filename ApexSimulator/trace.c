@@ -0,0 +1,164 @@
+/*
+ *  trace.c
+ *  Contains the binary pipeline trace writer and reader
+ *
+ *  Instead of formatting every stage with printf on every cycle, a traced
+ *  run appends one APEX_TraceRecord per cycle to an in-memory ring. A
+ *  record only takes the stage lines it uses, so a wide pipeline does not
+ *  make the trace of a scalar one any bigger. The ring is written out with
+ *  a single fwrite whenever it fills up and when the trace is closed.
+ *  apex_trace turns the file back into the text printed by a simulate run.
+ *
+ *  File layout : APEX_TraceHeader followed by the records, each the
+ *  clock and num_stages fields of APEX_TraceRecord and then its lines
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+#define TRACE_MAGIC "APEXTRCE"
+#define TRACE_VERSION 2
+
+/* Bytes buffered before a write */
+#define TRACE_RING_SIZE (1 << 20)
+
+/* Bytes of a record in the file before its lines */
+#define TRACE_RECORD_HEADER offsetof(APEX_TraceRecord, stages)
+
+typedef struct APEX_TraceHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t line_size;
+} APEX_TraceHeader;
+
+struct APEX_Trace
+{
+  FILE* fp;
+  char* ring;
+  size_t used;                // Bytes in the ring, the current record included
+  APEX_TraceRecord* current;  // Record of the current cycle in the ring, NULL if none
+};
+
+static int
+trace_flush(APEX_Trace* trace)
+{
+  int result = 0;
+  if (trace->used && fwrite(trace->ring, 1, trace->used, trace->fp) != trace->used) {
+    result = -1;
+  }
+  trace->used = 0;
+  trace->current = NULL;
+  return result;
+}
+
+APEX_Trace*
+APEX_trace_open(const char* path)
+{
+  APEX_Trace* trace = calloc(1, sizeof(*trace));
+  if (!trace) {
+    return NULL;
+  }
+  trace->ring = malloc(TRACE_RING_SIZE);
+  trace->fp = fopen(path, "wb");
+  if (!trace->ring || !trace->fp) {
+    if (trace->fp) {
+      fclose(trace->fp);
+    }
+    free(trace->ring);
+    free(trace);
+    return NULL;
+  }
+
+  APEX_TraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.line_size = sizeof(APEX_TraceStage);
+  fwrite(&header, sizeof(header), 1, trace->fp);
+  return trace;
+}
+
+/* Starts the record of a new clock cycle */
+void
+APEX_trace_cycle(APEX_Trace* trace, int clock)
+{
+  /* Leave room for all the lines the record may take */
+  if (trace->used + sizeof(APEX_TraceRecord) > TRACE_RING_SIZE) {
+    trace_flush(trace);
+  }
+  APEX_TraceRecord* record = (APEX_TraceRecord*) (trace->ring + trace->used);
+  record->clock = clock;
+  record->num_stages = 0;
+  memset(record->unused, 0, sizeof(record->unused));
+  trace->used += TRACE_RECORD_HEADER;
+  trace->current = record;
+}
+
+/* Appends a stage line to the current cycle, in the order they would be printed */
+void
+APEX_trace_stage(APEX_Trace* trace, int stage_id, const CPU_Stage* stage, int is_active)
+{
+  APEX_TraceRecord* record = trace->current;
+  if (!record || record->num_stages == APEX_TRACE_MAX_LINES) {
+    return;
+  }
+  trace->used += sizeof(APEX_TraceStage);
+  record->stages[record->num_stages++] = (APEX_TraceStage) {
+    .pc = stage->pc,
+    .imm = stage->imm,
+    .op = stage->op,
+    .rd = stage->rd,
+    .rs1 = stage->rs1,
+    .rs2 = stage->rs2,
+    .rs3 = stage->rs3,
+    .stage = stage_id,
+    .is_active = is_active,
+  };
+}
+
+int
+APEX_trace_close(APEX_Trace* trace)
+{
+  int result = trace_flush(trace);
+  if (fclose(trace->fp) != 0) {
+    result = -1;
+  }
+  free(trace->ring);
+  free(trace);
+  return result;
+}
+
+/*
+ * Opens a trace file for reading, returns NULL if it is not a trace
+ * written by this build.
+ */
+FILE*
+APEX_trace_open_reader(const char* path)
+{
+  FILE* fp = fopen(path, "rb");
+  if (!fp) {
+    return NULL;
+  }
+  APEX_TraceHeader header;
+  if (fread(&header, sizeof(header), 1, fp) != 1 ||
+      memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != TRACE_VERSION ||
+      header.line_size != sizeof(APEX_TraceStage)) {
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
+
+/* Reads the next record, returns 0 at the end of the trace */
+int
+APEX_trace_read(FILE* fp, APEX_TraceRecord* record)
+{
+  if (fread(record, TRACE_RECORD_HEADER, 1, fp) != 1 || record->num_stages > APEX_TRACE_MAX_LINES) {
+    return 0;
+  }
+  return fread(record->stages, sizeof(APEX_TraceStage), record->num_stages, fp) == record->num_stages;
+}
@@ -0,0 +1,135 @@
+/*
+ *  trace_tool.c
+ *  apex_trace : prints a binary trace recorded by apex_sim trace=
+ *
+ *  Without filters the output is exactly the per-cycle text a simulate
+ *  run prints. Filters select a subset:
+ *
+ *    from=<cycle> to=<cycle>   Only cycles in this range
+ *    stage=<F|DRF|EX1|EX2|MEM1|MEM2|WB>
+ *                              Only lines of this stage
+ *    pc=<pc>                   Only lines holding the instruction at pc
+ *
+ *  With a stage or pc filter, cycles without a matching line are skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+static const char* const stage_short_names[NUM_STAGES] = {
+  [F] = "F",
+  [DRF] = "DRF",
+  [EX1] = "EX1",
+  [EX2] = "EX2",
+  [MEM1] = "MEM1",
+  [MEM2] = "MEM2",
+  [WB] = "WB",
+};
+
+typedef struct Filter
+{
+  int from;
+  int to;
+  int stage;  // -1 for every stage
+  int pc;     // -1 for every pc
+} Filter;
+
+static int
+line_matches(const Filter* filter, const APEX_TraceStage* line)
+{
+  if (filter->stage >= 0 && line->stage != filter->stage) {
+    return 0;
+  }
+  if (filter->pc >= 0 && !(line->is_active && line->pc == filter->pc)) {
+    return 0;
+  }
+  return 1;
+}
+
+static void
+print_record(const Filter* filter, const APEX_TraceRecord* record)
+{
+  int num_lines = record->num_stages < APEX_TRACE_MAX_LINES ? record->num_stages : APEX_TRACE_MAX_LINES;
+  int matches = 0;
+  for (int i = 0; i < num_lines; ++i) {
+    matches += line_matches(filter, &record->stages[i]);
+  }
+  if (!matches && (filter->stage >= 0 || filter->pc >= 0)) {
+    return;
+  }
+
+  printf("--------------------------------\n");
+  printf("Clock Cycle #: %d\n", record->clock);
+  printf("--------------------------------\n");
+  for (int i = 0; i < num_lines; ++i) {
+    const APEX_TraceStage* line = &record->stages[i];
+    if (!line_matches(filter, line) || line->stage >= NUM_STAGES) {
+      continue;
+    }
+    CPU_Stage stage;
+    memset(&stage, 0, sizeof(stage));
+    stage.pc = line->pc;
+    stage.imm = line->imm;
+    stage.op = line->op < NUM_OPCODES ? line->op : OP_NONE;
+    stage.rd = line->rd;
+    stage.rs1 = line->rs1;
+    stage.rs2 = line->rs2;
+    stage.rs3 = line->rs3;
+    print_stage_content(stage_names[line->stage], &stage, line->is_active);
+  }
+}
+
+int
+main(int argc, char const* argv[])
+{
+  Filter filter = { 0, -1, -1, -1 };
+  const char* path = NULL;
+  int usage = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "from=", 5) == 0) {
+      filter.from = strtol(argv[i] + 5, NULL, 0);
+    } else if (strncmp(argv[i], "to=", 3) == 0) {
+      filter.to = strtol(argv[i] + 3, NULL, 0);
+    } else if (strncmp(argv[i], "pc=", 3) == 0) {
+      filter.pc = strtol(argv[i] + 3, NULL, 0);
+    } else if (strncmp(argv[i], "stage=", 6) == 0) {
+      for (int s = 0; s < NUM_STAGES; ++s) {
+        if (strcmp(argv[i] + 6, stage_short_names[s]) == 0) {
+          filter.stage = s;
+        }
+      }
+      usage |= filter.stage < 0;
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      usage = 1;
+    }
+  }
+  if (!path || usage) {
+    fprintf(stderr, "APEX_Help : Usage %s <trace_file> [from=<cycle>] [to=<cycle>] "
+                    "[stage=<F|DRF|EX1|EX2|MEM1|MEM2|WB>] [pc=<pc>]\n", argv[0]);
+    exit(1);
+  }
+
+  FILE* fp = APEX_trace_open_reader(path);
+  if (!fp) {
+    fprintf(stderr, "APEX_Error : %s is not a trace written by this build of the simulator\n", path);
+    exit(1);
+  }
+
+  APEX_TraceRecord record;
+  while (APEX_trace_read(fp, &record)) {
+    if (record.clock < filter.from) {
+      continue;
+    }
+    if (filter.to >= 0 && record.clock > filter.to) {
+      break;
+    }
+    print_record(&filter, &record);
+  }
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ *  workload.c
+ *  apex_gen : writes large parameterized APEX programs for benchmarking
+ *
+ *  Usage : apex_gen <kind> [key=value ...] > program.asm
+ *
+ *    chain  dist= length= iters=   Register dependency chains, every ADD
+ *                                  reads the result of the ADD dist
+ *                                  instructions before it (dist 1..8)
+ *    stream words= unroll= iters=  Copies words data words with alternating
+ *                                  LOAD/LDR and STR, unroll copies per loop
+ *    loops  outer= inner= body=    Nested loops: the inner one exits with BZ
+ *                                  and loops back with JUMP, the outer one
+ *                                  loops with BNZ
+ *    mul    dist= length= iters=   Like chain, with MUL doing three out of
+ *                                  every four operations
+ *
+ *  Every program runs its kernel iters times (outer times for loops) and
+ *  ends with HALT. R0 is kept 0 and R9 is kept 1; loop counters live in
+ *  R14 and R15.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Params
+{
+  int dist;
+  int length;
+  int iters;
+  int words;
+  int unroll;
+  int outer;
+  int inner;
+  int body;
+} Params;
+
+/* Instructions written so far, the index of the next one */
+static int num_written;
+
+/* Writes one instruction line */
+static void __attribute__((format(printf, 1, 2)))
+emit(const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+  num_written++;
+}
+
+/* Address of the instruction at index */
+static int
+address_of(int index)
+{
+  return 4000 + index * 4;
+}
+
+/* Common prologue: R0 = 0, R9 = 1, R1-R8 = 0 */
+static void
+emit_prologue(void)
+{
+  emit("MOVC,R0,#0");
+  emit("MOVC,R9,#1");
+  for (int r = 1; r <= 8; ++r) {
+    emit("MOVC,R%d,#0", r);
+  }
+}
+
+/* Decrements counter and branches back to the instruction at start while it is not zero */
+static void
+emit_loop_back(int counter, int start)
+{
+  emit("SUBL,R%d,R%d,#1", counter, counter);
+  emit("BNZ,#%d", (start - num_written) * 4);
+}
+
+static void
+gen_chain(const Params* p, int use_mul)
+{
+  emit_prologue();
+  emit("MOVC,R15,#%d", p->iters);
+  int start = num_written;
+  for (int i = 0; i < p->length; ++i) {
+    int r = 1 + i % p->dist;
+    if (use_mul && i % 4 != 3) {
+      emit("MUL,R%d,R%d,R9", r, r);
+    } else {
+      emit("ADD,R%d,R%d,R9", r, r);
+    }
+  }
+  emit_loop_back(15, start);
+  emit("HALT");
+}
+
+static void
+gen_stream(const Params* p)
+{
+  emit_prologue();
+  emit("MOVC,R12,#2000");
+  emit("MOVC,R15,#%d", p->iters);
+  int outer = num_written;
+  emit("MOVC,R11,#0");
+  emit("MOVC,R14,#%d", p->words / p->unroll);
+  int inner = num_written;
+  for (int u = 0; u < p->unroll; ++u) {
+    int r = 1 + u % 8;
+    if (u % 2) {
+      emit("LDR,R%d,R0,R11", r);
+    } else {
+      emit("LOAD,R%d,R11,#0", r);
+    }
+    emit("STR,R%d,R12,R11", r);
+    emit("ADDL,R11,R11,#1");
+  }
+  emit_loop_back(14, inner);
+  emit_loop_back(15, outer);
+  emit("HALT");
+}
+
+static void
+gen_loops(const Params* p)
+{
+  emit_prologue();
+  emit("MOVC,R15,#%d", p->outer);
+  int outer = num_written;
+  emit("MOVC,R14,#%d", p->inner);
+  int inner = num_written;
+  for (int i = 0; i < p->body; ++i) {
+    int r = 1 + i % 8;
+    emit("ADDL,R%d,R%d,#%d", r, r, i + 1);
+  }
+  emit("SUBL,R14,R14,#1");
+  emit("BZ,#8");
+  emit("JUMP,R0,#%d", address_of(inner));
+  emit_loop_back(15, outer);
+  emit("HALT");
+}
+
+static void
+set_param(Params* p, const char* arg)
+{
+  static const struct
+  {
+    const char* key;
+    size_t offset;
+  } keys[] = {
+    { "dist", offsetof(Params, dist) },     { "length", offsetof(Params, length) },
+    { "iters", offsetof(Params, iters) },   { "words", offsetof(Params, words) },
+    { "unroll", offsetof(Params, unroll) }, { "outer", offsetof(Params, outer) },
+    { "inner", offsetof(Params, inner) },   { "body", offsetof(Params, body) },
+  };
+  const char* eq = strchr(arg, '=');
+  for (size_t i = 0; eq && i < sizeof(keys) / sizeof(keys[0]); ++i) {
+    if (strlen(keys[i].key) == (size_t) (eq - arg) && strncmp(arg, keys[i].key, eq - arg) == 0) {
+      *(int*) ((char*) p + keys[i].offset) = strtol(eq + 1, NULL, 0);
+      return;
+    }
+  }
+  fprintf(stderr, "APEX_Error : Unknown parameter %s\n", arg);
+  exit(1);
+}
+
+int
+main(int argc, char const* argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr, "APEX_Help : Usage %s <chain|stream|loops|mul> [key=value ...]\n", argv[0]);
+    exit(1);
+  }
+  Params p = { .dist = 1, .length = 64, .iters = 1000, .words = 1024, .unroll = 8,
+               .outer = 100, .inner = 100, .body = 4 };
+  for (int i = 2; i < argc; ++i) {
+    set_param(&p, argv[i]);
+  }
+
+  /* Keep the program inside the register file and data memory */
+  if (p.dist < 1 || p.dist > 8 || p.length < 1 || p.iters < 1 || p.unroll < 1 ||
+      p.words < p.unroll || p.words > 2000 || p.outer < 1 || p.inner < 1 || p.body < 0) {
+    fprintf(stderr, "APEX_Error : Parameter out of range\n");
+    exit(1);
+  }
+
+  const char* kind = argv[1];
+  if (strcmp(kind, "chain") == 0) {
+    gen_chain(&p, 0);
+  } else if (strcmp(kind, "mul") == 0) {
+    gen_chain(&p, 1);
+  } else if (strcmp(kind, "stream") == 0) {
+    gen_stream(&p);
+  } else if (strcmp(kind, "loops") == 0) {
+    gen_loops(&p);
+  } else {
+    fprintf(stderr, "APEX_Error : Unknown workload %s\n", kind);
+    exit(1);
+  }
+  return 0;
+}
@@ -1,10 +0,0 @@
-MOVC,R1,#11
-MOVC,R2,#22
-MOVC,R3,#5
-MOVC,R4,#50
-MOVC,R5,#51
-MOVC,R6,#52
-MOVC,R7,#53
-MOVC,R8,#54
-STORE,R1,R3,#10
-STORE,R2,R3,#15